@@ -0,0 +1,293 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "Engine.h"
+
+// Standard workloads run against whichever backend this binary was built with, printed as one JSON object.
+// Every workload runs several times and reports the fastest run, so results from different backends and
+// releases can be compared directly.
+//
+// Usage: WeaveECS_bench_<Backend> [--entities N] [--repeats N] [--output file.json]
+
+#ifndef WEAVE_BENCH_BACKEND
+#define WEAVE_BENCH_BACKEND "Unknown"
+#endif
+
+using namespace Weave::ECS;
+using Clock = std::chrono::steady_clock;
+
+struct Position { float x, y, z; };
+struct Velocity { float x, y, z; };
+struct Health { float value; };
+struct Mass { float value; };
+struct Tag { int value; };
+
+template <int Index>
+struct Fragment { float value; };
+
+static constexpr int FragmentTypes = 8; // 2^8 = 256 archetypes.
+
+static volatile float checksumSink;
+
+struct Result
+{
+	std::string name;
+	std::size_t operations;
+	double nanoseconds;
+};
+
+// Runs setup and measure repeats times and keeps the fastest measurement. measure returns the operation count.
+static Result Measure(const char* name, int repeats, const std::function<void()>& setup, const std::function<std::size_t()>& measure, const std::function<void()>& teardown = [] {})
+{
+	Result result{ name, 0, 0.0 };
+
+	for (int repeat = 0; repeat < repeats; repeat++)
+	{
+		setup();
+
+		Clock::time_point start = Clock::now();
+		std::size_t operations = measure();
+		std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+
+		teardown();
+
+		if (repeat == 0 || elapsed.count() < result.nanoseconds)
+		{
+			result.operations = operations;
+			result.nanoseconds = elapsed.count();
+		}
+	}
+
+	return result;
+}
+
+static void Populate(World& world, std::size_t count, std::vector<EntityID>& entities)
+{
+	entities.clear();
+	entities.reserve(count);
+
+	for (std::size_t i = 0; i < count; i++)
+	{
+		EntityID entity = world.CreateEntity();
+		world.AddComponents(entity, Position{ 0.0f, 0.0f, 0.0f }, Velocity{ 1.0f, 1.0f, 1.0f }, Health{ 100.0f }, Mass{ 1.0f });
+		entities.push_back(entity);
+	}
+}
+
+template <int... Indices>
+static void AddFragments(World& world, EntityID entity, unsigned mask, std::integer_sequence<int, Indices...>)
+{
+	([&] {
+		if (mask & (1u << Indices)) world.AddComponent(entity, Fragment<Indices>{ 1.0f });
+		}(), ...);
+}
+
+int main(int argc, char** argv)
+{
+	std::size_t entityCount = 1000000;
+	int repeats = 3;
+	const char* outputPath = nullptr;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (std::strcmp(argv[i], "--entities") == 0) entityCount = std::strtoull(argv[i + 1], nullptr, 10);
+		else if (std::strcmp(argv[i], "--repeats") == 0) repeats = std::max(1, std::atoi(argv[i + 1]));
+		else if (std::strcmp(argv[i], "--output") == 0) outputPath = argv[i + 1];
+	}
+
+	std::vector<Result> results;
+	std::unique_ptr<World> world;
+	std::vector<EntityID> entities;
+
+	auto freshWorld = [&] { world = std::make_unique<World>(); entities.clear(); };
+	auto populatedWorld = [&] { freshWorld(); Populate(*world, entityCount, entities); };
+
+	results.push_back(Measure("create_entities", repeats, freshWorld, [&] {
+		for (std::size_t i = 0; i < entityCount; i++) entities.push_back(world->CreateEntity());
+		return entityCount;
+		}));
+
+	results.push_back(Measure("destroy_entities", repeats, [&] {
+		freshWorld();
+		for (std::size_t i = 0; i < entityCount; i++) entities.push_back(world->CreateEntity());
+		}, [&] {
+		for (EntityID entity : entities) world->DeleteEntity(entity);
+		return entityCount;
+		}));
+
+	results.push_back(Measure("add_component", repeats, [&] {
+		freshWorld();
+		for (std::size_t i = 0; i < entityCount; i++)
+		{
+			entities.push_back(world->CreateEntity());
+			world->AddComponent(entities.back(), Position{});
+		}
+		}, [&] {
+		for (EntityID entity : entities) world->AddComponent(entity, Velocity{});
+		return entityCount;
+		}));
+
+	results.push_back(Measure("remove_component", repeats, populatedWorld, [&] {
+		for (EntityID entity : entities) world->RemoveComponent<Velocity>(entity);
+		return entityCount;
+		}));
+
+	populatedWorld();
+
+	results.push_back(Measure("iterate_1_component", repeats, [] {}, [&] {
+		WorldView<Position> view = world->GetView<Position>();
+		view.ForEach([](EntityID, Position& position) { position.x += 1.0f; });
+		return view.GetEntityCount();
+		}));
+
+	results.push_back(Measure("iterate_2_components", repeats, [] {}, [&] {
+		WorldView<Position, Velocity> view = world->GetView<Position, Velocity>();
+		view.ForEach([](EntityID, Position& position, const Velocity& velocity) {
+			position.x += velocity.x;
+			position.y += velocity.y;
+			position.z += velocity.z;
+			});
+		return view.GetEntityCount();
+		}));
+
+	results.push_back(Measure("iterate_4_components", repeats, [] {}, [&] {
+		WorldView<Position, Velocity, Health, Mass> view = world->GetView<Position, Velocity, Health, Mass>();
+		view.ForEach([](EntityID, Position& position, const Velocity& velocity, Health& health, const Mass& mass) {
+			position.x += velocity.x * mass.value;
+			health.value -= 0.01f;
+			});
+		return view.GetEntityCount();
+		}));
+
+	{
+		std::vector<EntityID> shuffled = entities;
+		std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(12345));
+
+		results.push_back(Measure("random_try_get_component", repeats, [] {}, [&] {
+			float sum = 0.0f;
+
+			for (EntityID entity : shuffled)
+			{
+				if (Velocity* velocity = world->TryGetComponent<Velocity>(entity)) sum += velocity->x;
+			}
+
+			checksumSink = sum;
+			return shuffled.size();
+			}));
+	}
+
+	freshWorld();
+
+	for (std::size_t i = 0; i < entityCount; i++)
+	{
+		EntityID entity = world->CreateEntity();
+		world->AddComponent(entity, Position{});
+		AddFragments(*world, entity, static_cast<unsigned>(i % (1u << FragmentTypes)), std::make_integer_sequence<int, FragmentTypes>());
+	}
+
+	results.push_back(Measure("fragmented_iterate_256_archetypes", repeats, [] {}, [&] {
+		WorldView<Position> view = world->GetView<Position>();
+		view.ForEach([](EntityID, Position& position) { position.x += 1.0f; });
+		return view.GetEntityCount();
+		}));
+
+	{
+		CommandBuffer commands;
+
+		results.push_back(Measure("command_buffer_flush_add", repeats, [&] {
+			populatedWorld();
+			for (EntityID entity : entities) commands.AddComponents(entity, Tag{ 1 });
+			}, [&] {
+			commands.Flush(*world);
+			return entityCount;
+			}));
+
+		results.push_back(Measure("command_buffer_flush_remove", repeats, [&] {
+			populatedWorld();
+			for (EntityID entity : entities) world->AddComponent(entity, Tag{ 1 });
+			for (EntityID entity : entities) commands.RemoveComponents<Tag>(entity);
+			}, [&] {
+			commands.Flush(*world);
+			return entityCount;
+			}));
+	}
+
+	world.reset();
+
+	std::size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	{
+		Engine engine(static_cast<std::uint8_t>(std::min<std::size_t>(threadCount, 255)));
+		Populate(engine.GetWorld(), entityCount, entities);
+
+		SystemGroupID serialGroup = engine.CreateSystemGroup();
+		engine.RegisterSystem(serialGroup, [](EntityID, Position& position, const Velocity& velocity) {
+			position.x += velocity.x;
+			position.y += velocity.y;
+			position.z += velocity.z;
+			});
+
+		SystemGroupID threadedGroup = engine.CreateSystemGroup();
+		engine.RegisterSystemThreaded(threadedGroup, [](EntityID, Position& position, const Velocity& velocity) {
+			position.x += velocity.x;
+			position.y += velocity.y;
+			position.z += velocity.z;
+			});
+
+		// Every entity records a command from a threaded system, the group flushes them when it ends.
+		bool tagged = false;
+		SystemGroupID commandGroup = engine.CreateSystemGroup();
+		engine.RegisterSystemThreaded(commandGroup, [&tagged](EntityID entity, const Position&, CommandBuffer& commands) {
+			if (tagged) commands.RemoveComponents<Tag>(entity);
+			else commands.AddComponents(entity, Tag{ 1 });
+			});
+
+		results.push_back(Measure("serial_system", repeats, [] {}, [&] {
+			engine.CallSystemGroup(serialGroup);
+			return entityCount;
+			}));
+
+		results.push_back(Measure("threaded_system", repeats, [] {}, [&] {
+			engine.CallSystemGroup(threadedGroup);
+			return entityCount;
+			}));
+
+		results.push_back(Measure("threaded_system_with_commands", repeats, [] {}, [&] {
+			engine.CallSystemGroup(commandGroup);
+			return entityCount;
+			}, [&] { tagged = !tagged; }));
+	}
+
+	std::FILE* output = outputPath ? std::fopen(outputPath, "w") : stdout;
+	if (!output)
+	{
+		std::fprintf(stderr, "Could not open %s\n", outputPath);
+		return 1;
+	}
+
+	std::fprintf(output, "{\n  \"backend\": \"%s\",\n  \"entities\": %zu,\n  \"repeats\": %d,\n  \"threads\": %zu,\n  \"results\": [\n",
+		WEAVE_BENCH_BACKEND, entityCount, repeats, threadCount);
+
+	for (std::size_t i = 0; i < results.size(); i++)
+	{
+		const Result& result = results[i];
+		double perOperation = result.operations > 0 ? result.nanoseconds / static_cast<double>(result.operations) : 0.0;
+
+		std::fprintf(output, "    { \"name\": \"%s\", \"operations\": %zu, \"total_ms\": %.3f, \"ns_per_operation\": %.2f }%s\n",
+			result.name.c_str(), result.operations, result.nanoseconds / 1e6, perOperation, i + 1 < results.size() ? "," : "");
+	}
+
+	std::fprintf(output, "  ]\n}\n");
+
+	if (output != stdout) std::fclose(output);
+	return 0;
+}
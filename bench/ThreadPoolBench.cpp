@@ -0,0 +1,95 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "ThreadPool.h"
+
+// Contention benchmark for Utilities::ThreadPool. Measures the cost of many tiny tasks submitted from outside
+// the pool, and of tasks that spawn their own subtasks from inside it.
+
+using Clock = std::chrono::steady_clock;
+
+static double SubmitTinyTasks(Weave::Utilities::ThreadPool& pool, std::size_t taskCount)
+{
+	std::atomic<std::size_t> counter{ 0 };
+
+	Clock::time_point start = Clock::now();
+
+	for (std::size_t i = 0; i < taskCount; i++)
+	{
+		pool.Enqueue([&counter]() { counter.fetch_add(1, std::memory_order_relaxed); });
+	}
+
+	pool.WaitAll();
+
+	std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+
+	if (counter.load() != taskCount) std::abort();
+	return elapsed.count() / taskCount;
+}
+
+static double SpawnSubtasks(Weave::Utilities::ThreadPool& pool, std::size_t rootCount, std::size_t childrenPerRoot)
+{
+	std::atomic<std::size_t> counter{ 0 };
+
+	Clock::time_point start = Clock::now();
+
+	for (std::size_t i = 0; i < rootCount; i++)
+	{
+		pool.Enqueue([&pool, &counter, childrenPerRoot]() {
+			for (std::size_t child = 0; child < childrenPerRoot; child++)
+			{
+				pool.Enqueue([&counter]() { counter.fetch_add(1, std::memory_order_relaxed); });
+			}
+			});
+	}
+
+	pool.WaitAll();
+
+	std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+
+	if (counter.load() != rootCount * childrenPerRoot) std::abort();
+	return elapsed.count() / (rootCount * (childrenPerRoot + 1));
+}
+
+static double ParallelForSmallRange(Weave::Utilities::ThreadPool& pool, std::size_t iterations, std::size_t rangeSize)
+{
+	std::atomic<std::size_t> counter{ 0 };
+
+	Clock::time_point start = Clock::now();
+
+	for (std::size_t i = 0; i < iterations; i++)
+	{
+		pool.ParallelFor(rangeSize, 0, [&counter](std::size_t begin, std::size_t end) {
+			counter.fetch_add(end - begin, std::memory_order_relaxed);
+			});
+	}
+
+	std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+
+	if (counter.load() != iterations * rangeSize) std::abort();
+	return elapsed.count() / iterations;
+}
+
+int main(int argc, char** argv)
+{
+	std::size_t taskCount = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+
+	std::printf("[\n");
+
+	const std::size_t threadCounts[] = { 1, 4, 16 };
+	for (std::size_t i = 0; i < std::size(threadCounts); i++)
+	{
+		Weave::Utilities::ThreadPool pool(threadCounts[i]);
+
+		double submitNs = SubmitTinyTasks(pool, taskCount);
+		double spawnNs = SpawnSubtasks(pool, taskCount / 100, 99);
+		double parallelForNs = ParallelForSmallRange(pool, taskCount / 100, 4096);
+
+		std::printf("  { \"threads\": %zu, \"tasks\": %zu, \"external_submit_ns_per_task\": %.1f, \"subtask_spawn_ns_per_task\": %.1f, \"parallel_for_4096_ns_per_call\": %.1f }%s\n",
+			threadCounts[i], taskCount, submitNs, spawnNs, parallelForNs, i + 1 < std::size(threadCounts) ? "," : "");
+	}
+
+	std::printf("]\n");
+	return 0;
+}
@@ -8,6 +8,18 @@
 #include <set>
 #include <iostream>
 #include <mutex>
+#include <cstring>
+#include <algorithm>
+#include <tuple>
+#include <span>
+#include <new>
+#include <utility>
+#include <atomic>
+#include <memory_resource>
+#include "ComponentTraits.h"
+#include "ComponentInfo.h"
+#include "MemoryStats.h"
+#include "../SparseSet/SparseSet.h"
 
 namespace Weave
 {
@@ -21,27 +33,44 @@ namespace Weave
 		template <typename... QueryComponents, typename... Components>
 		concept ValidQuery = (IsContainedIn<QueryComponents, Components...> && ...);
 
+		template <typename Component>
+		using ComponentSource = std::conditional_t<SparseComponent<Component>, SparseSet<Component>*, Component*>;
+
 		template <typename... Components>
 		class ArchetypeView
 		{
 		private:
-			std::vector<EntityID>* entities; 
-			std::tuple<std::vector<Components>*...> componentVectors;
+			const EntityID* entities;
+			const std::size_t* rows; // Matching rows when sparse components filter the archetype, nullptr when every row matches.
+			std::size_t count;
+			std::tuple<ComponentSource<Components>...> componentSources;
+
+			template <typename Component>
+			Component& Fetch(std::size_t row, EntityID entity) const
+			{
+				if constexpr (SparseComponent<Component>)
+				{
+					return *std::get<SparseSet<Component>*>(componentSources)->Get(entity);
+				}
+				else
+				{
+					return std::get<Component*>(componentSources)[row];
+				}
+			}
 
 		public:
-			ArchetypeView(std::vector<EntityID>& entities, std::vector<Components>&... components)
-				: entities(&entities), componentVectors(&components...) {}
+			ArchetypeView(const EntityID* entities, const std::size_t* rows, std::size_t count, ComponentSource<Components>... sources)
+				: entities(entities), rows(rows), count(count), componentSources(sources...) {}
 
 			class Iterator
 			{
 			private:
 				size_t index;
-				std::vector<EntityID>* entities;
-				std::tuple<std::vector<Components>*...> componentVectors;
+				const ArchetypeView* view;
 
 			public:
-				Iterator(size_t idx, std::vector<EntityID>* entities, std::tuple<std::vector<Components>*...> components)
-					: index(idx), entities(entities), componentVectors(components) {}
+				Iterator(size_t idx, const ArchetypeView* view)
+					: index(idx), view(view) {}
 
 				Iterator(const Iterator&) = default;
 				Iterator& operator=(const Iterator&) = default;
@@ -51,7 +80,7 @@ namespace Weave
 
 				bool operator==(const Iterator& other) const
 				{
-					return index == other.index && entities == other.entities;
+					return index == other.index && view == other.view;
 				}
 
 				Iterator& operator++()
@@ -67,229 +96,548 @@ namespace Weave
 
 				auto operator*()
 				{
-					return std::tuple<EntityID, Components&...>((*entities)[index], (*std::get<std::vector<Components>*>(componentVectors))[index]...);
+					std::size_t row = view->rows ? view->rows[index] : index;
+					EntityID entity = view->entities[row];
+					return std::tuple<EntityID, Components&...>(entity, view->template Fetch<Components>(row, entity)...);
 				}
 			};
 
-			Iterator begin() { return Iterator(0, entities, componentVectors); }
-			Iterator end() { return Iterator(entities->size(), entities, componentVectors); }
-            Iterator at(size_t index) { return Iterator(index, entities, componentVectors); }
+			Iterator begin() const { return Iterator(0, this); }
+			Iterator end() const { return Iterator(count, this); }
+			Iterator at(size_t index) const { return Iterator(index, this); }
 
-            std::size_t GetEntityCount()
-            {
-                return entities->size();
-            }
-		};
+			std::size_t GetEntityCount() const
+			{
+				return count;
+			}
 
-        struct ComponentStore
-        {
-            void* data;
-            std::size_t componentSize;
-            void(*destroy)(const void*);
-        };
+			// Calls fn(entity, components...) for the rows in [begin, end) without going through the iterator.
+			template <typename F>
+			void ForEach(std::size_t begin, std::size_t end, F&& fn) const
+			{
+				for (std::size_t index = begin; index < end; index++)
+				{
+					std::size_t row = rows ? rows[index] : index;
+					EntityID entity = entities[row];
+					fn(entity, Fetch<Components>(row, entity)...);
+				}
+			}
+		};
 
-        struct ComponentData
+        // Rows of a column copied for rollback. A copy is never changed while it is shared, so snapshots share
+        // it for as long as the column stays the same.
+        class ColumnCopy
         {
-            std::type_index index;
-            std::size_t size;
-            void(*destructor)(const void*);
+        private:
+            const ComponentInfo* info;
+            std::pmr::memory_resource* resource;
+            std::byte* data = nullptr;
+            std::size_t count = 0;
+            std::size_t capacity = 0;
 
-            bool operator<(const ComponentData& other) const 
+            void Clear()
             {
-                if (index != other.index) 
+                if (!info->triviallyCopyable)
                 {
-                    return index < other.index;
+                    for (std::size_t row = 0; row < count; row++) info->destroy(data + row * info->size);
                 }
 
-                return size < other.size;
+                count = 0;
             }
 
-            template <typename T>
-            static ComponentData GetComponentData()
+        public:
+            ColumnCopy(const ComponentInfo& info, std::pmr::memory_resource* resource)
+                : info(&info), resource(resource) {}
+
+            ColumnCopy(const ColumnCopy&) = delete;
+            ColumnCopy& operator=(const ColumnCopy&) = delete;
+
+            ~ColumnCopy()
             {
-                return ComponentData(typeid(T), sizeof(T), [](const void* x) { static_cast<const T*>(x)->~T(); } );
+                Clear();
+                if (data) resource->deallocate(data, capacity * info->size, info->alignment);
             }
-        };
 
-        class Archetype 
-        {
-        private:
-            std::vector<EntityID> entities;
-            std::unordered_map<std::type_index, ComponentStore> components;
-            std::set<std::type_index> validTypes;
+            const ComponentInfo& GetInfo() const
+            {
+                return *info;
+            }
+
+            std::size_t Size() const
+            {
+                return count;
+            }
+
+            const void* Get(std::size_t row) const
+            {
+                return data + row * info->size;
+            }
 
-            size_t GetEntityIndex(EntityID entity) 
+            // Replaces the copy with copies of rows, throws when the component type isn't copy constructible.
+            void Assign(const std::byte* rows, std::size_t rowCount)
             {
-                auto it = std::find(entities.begin(), entities.end(), entity);
+                Clear();
 
-                if (it == entities.end())
+                if (rowCount > capacity)
                 {
-                    throw std::runtime_error("Entity not found in archetype");
+                    if (data) resource->deallocate(data, capacity * info->size, info->alignment);
+
+                    data = nullptr;
+                    capacity = 0;
+                    data = static_cast<std::byte*>(resource->allocate(rowCount * info->size, info->alignment));
+                    capacity = rowCount;
+                }
+
+                if (info->triviallyCopyable)
+                {
+                    if (rowCount > 0) std::memcpy(data, rows, rowCount * info->size);
+                    count = rowCount;
+                    return;
                 }
 
-                return std::distance(entities.begin(), it);
+                for (; count < rowCount; count++) info->copyConstruct(data + count * info->size, rows + count * info->size);
             }
 
-            void RemoveEntityAt(size_t index)
+            // Copy constructs every row into uninitialized memory.
+            void CopyTo(std::byte* destination) const
             {
-                size_t last = entities.size() - 1;
-                if (index != last)
+                if (info->triviallyCopyable)
                 {
-                    entities[index] = entities[last];
-
-                    for (auto& [type, store] : components)
-                    {
-                        std::vector<std::byte>* componentVec = static_cast<std::vector<std::byte>*>(store.data);
-                        std::memcpy(componentVec->data() + index * store.componentSize, componentVec->data() + last * store.componentSize, store.componentSize);
-                    }
+                    if (count > 0) std::memcpy(destination, data, count * info->size);
+                    return;
                 }
 
-                entities.pop_back();
-                for (auto& [type, store] : components)
+                for (std::size_t row = 0; row < count; row++) info->copyConstruct(destination + row * info->size, data + row * info->size);
+            }
+        };
+
+        // Type erased storage for one component type of an archetype. Rows past the end are uninitialized,
+        // callers construct into rows they grow and relocate or destroy rows before they are removed. Rows are
+        // allocated from the World's memory resource.
+        class Column
+        {
+        private:
+            const ComponentInfo* info;
+            std::pmr::memory_resource* resource;
+            std::byte* data = nullptr;
+            std::size_t count = 0;
+            std::size_t capacity = 0;
+            bool ownsData = true; // False while the rows live in memory adopted from a snapshot.
+
+            // Set whenever rows may have been written, which is any non-const access. Cleared by Capture and Restore.
+            std::atomic<bool> modified = true;
+            std::shared_ptr<const ColumnCopy> capture;
+
+            void Reallocate(std::size_t newCapacity)
+            {
+                std::byte* newData = static_cast<std::byte*>(resource->allocate(newCapacity * info->size, info->alignment));
+
+                if (info->triviallyCopyable)
+                {
+                    if (count > 0) std::memcpy(newData, data, count * info->size);
+                }
+                else
                 {
-                    static_cast<std::vector<std::byte>*>(store.data)->resize(last * store.componentSize);
+                    for (std::size_t row = 0; row < count; row++) info->Relocate(newData + row * info->size, data + row * info->size);
                 }
+
+                if (data && ownsData) resource->deallocate(data, capacity * info->size, info->alignment);
+
+                data = newData;
+                capacity = newCapacity;
+                ownsData = true;
             }
 
         public:
-            explicit Archetype(const std::set<ComponentData> types)
+            Column(const ComponentInfo& info, std::pmr::memory_resource* resource)
+                : info(&info), resource(resource) {}
+
+            Column(const Column&) = delete;
+            Column& operator=(const Column&) = delete;
+
+            Column(Column&& other) noexcept
+                : info(other.info), resource(other.resource), data(std::exchange(other.data, nullptr)), count(std::exchange(other.count, 0)), capacity(std::exchange(other.capacity, 0)),
+                ownsData(std::exchange(other.ownsData, true)), modified(other.modified.load(std::memory_order_relaxed)), capture(std::move(other.capture)) {}
+
+            ~Column()
             {
-                for (const auto& type : types)
+                if (!data) return;
+
+                if (!info->triviallyCopyable)
                 {
-                    components[type.index] = { new std::vector<std::byte>(), type.size, type.destructor };
-                    validTypes.insert(type.index);
+                    for (std::size_t row = 0; row < count; row++) info->destroy(Get(row));
                 }
+
+                if (ownsData) resource->deallocate(data, capacity * info->size, info->alignment);
             }
 
-            ~Archetype() 
+            const ComponentInfo& GetInfo() const
             {
-                for (auto& [type, store] : components) 
-                {
-                    delete static_cast<std::vector<std::byte>*>(store.data);
-                }
+                return *info;
             }
 
-            std::set<std::type_index> GetComponentTypes() 
+            std::size_t Size() const
             {
-                return validTypes;
+                return count;
             }
 
-            std::set<ComponentData> GetComponentData()
+            std::size_t GetCapacity() const
             {
-                std::set<ComponentData> data;
+                return capacity;
+            }
 
-                for (std::type_index type : validTypes)
-                {
-                    ComponentStore store = components[type];
-                    data.insert({ type, store.componentSize, store.destroy });
-                }
+            void* Get(std::size_t row)
+            {
+                modified.store(true, std::memory_order_relaxed);
+                return data + row * info->size;
+            }
+
+            // Views of const components leave the column unmodified.
+            template <typename Component>
+            Component* Data()
+            {
+                if constexpr (!std::is_const_v<Component>) modified.store(true, std::memory_order_relaxed);
+                return std::launder(reinterpret_cast<Component*>(data));
+            }
+
+            void Reserve(std::size_t rows)
+            {
+                if (rows > capacity) Reallocate(std::max({ rows, capacity * 2, std::size_t(8) }));
+            }
+
+            // Appends uninitialized rows and returns the first of them.
+            void* Grow(std::size_t rows)
+            {
+                Reserve(count + rows);
+                void* first = Get(count);
+                count += rows;
+
+                return first;
+            }
+
+            // Moves the last row into a row whose component was already relocated or destroyed, then shrinks by one.
+            // Counts as a change even for the last row, which only shrinks the column.
+            void FillFromBack(std::size_t row)
+            {
+                modified.store(true, std::memory_order_relaxed);
+
+                std::size_t last = count - 1;
+                if (row != last) info->Relocate(Get(row), Get(last));
+
+                count--;
+            }
+
+            // Drops the last rows, their components must already be relocated or destroyed.
+            void Truncate(std::size_t rows)
+            {
+                modified.store(true, std::memory_order_relaxed);
+                count = rows;
+            }
+
+            // Uses rows of a trivially copyable type in place, without copying them. The memory must outlive the
+            // column or its next reallocation, which copies the rows into memory of its own. The column must be empty.
+            void Adopt(std::byte* rows, std::size_t rowCount)
+            {
+                if (data && ownsData) resource->deallocate(data, capacity * info->size, info->alignment);
+
+                data = rows;
+                count = rowCount;
+                capacity = rowCount;
+                ownsData = false;
+                modified.store(true, std::memory_order_relaxed);
+            }
+
+            // Copies the rows for rollback, or returns the last copy while the column is unchanged since it was
+            // captured or restored. reuse is an older copy whose memory is reused when nothing else shares it.
+            std::shared_ptr<const ColumnCopy> Capture(std::shared_ptr<const ColumnCopy> reuse)
+            {
+                if (!modified.load(std::memory_order_relaxed) && capture) return capture;
 
-                return data;
+                capture.reset();
+
+                std::shared_ptr<ColumnCopy> copy = std::const_pointer_cast<ColumnCopy>(std::move(reuse));
+                if (!copy || copy.use_count() != 1) copy = std::make_shared<ColumnCopy>(*info, resource);
+
+                copy->Assign(data, count);
+
+                capture = std::move(copy);
+                modified.store(false, std::memory_order_relaxed);
+
+                return capture;
             }
 
-            template <typename... Components>
-            void AddEntity(EntityID entity, Components... componentData) 
+            // Replaces the rows with a copy from Capture, a null copy empties the column.
+            void Restore(const std::shared_ptr<const ColumnCopy>& copy)
             {
-                entities.push_back(entity);
+                if (copy == capture && !modified.load(std::memory_order_relaxed)) return;
 
-                for (std::pair<const std::type_index, ComponentStore> componentPair : components)
+                if (!info->triviallyCopyable)
                 {
-                    if (((typeid(Components) == componentPair.first) || ...)) continue;
+                    for (std::size_t row = 0; row < count; row++) info->destroy(data + row * info->size);
+                }
+
+                count = 0;
 
-                    std::vector<std::byte>* componentVector = static_cast<std::vector<std::byte>*>(componentPair.second.data);
-                    componentVector->resize(entities.size() * componentPair.second.componentSize);
+                if (copy)
+                {
+                    Reserve(copy->Size());
+                    copy->CopyTo(data);
+                    count = copy->Size();
                 }
 
-                (GetComponentVector<Components>().emplace_back(std::move(componentData)), ...);
+                capture = copy;
+                modified.store(!copy, std::memory_order_relaxed);
             }
+        };
+
+        // An archetype's entities and columns captured for rollback, see Archetype::Capture.
+        struct ArchetypeCopy
+        {
+            std::shared_ptr<const std::vector<EntityID>> entities;
+            std::vector<std::shared_ptr<const ColumnCopy>> columns;
+        };
 
-            void RemoveEntity(EntityID entity)
+        class Archetype 
+        {
+        private:
+            std::pmr::vector<EntityID> entities;
+
+            // Set by every change to the entity array, cleared by Capture and Restore.
+            bool entitiesModified = true;
+            std::shared_ptr<const std::vector<EntityID>> entitiesCapture;
+
+            std::vector<Column> columns;
+            std::unordered_map<std::type_index, std::size_t> columnIndices;
+            std::set<std::type_index> validTypes;
+
+        public:
+            Archetype(const std::vector<const ComponentInfo*>& infos, std::pmr::memory_resource* resource)
+                : entities(resource)
             {
-                auto it = std::find(entities.begin(), entities.end(), entity);
-                if (it != entities.end())
+                columns.reserve(infos.size());
+
+                for (const ComponentInfo* info : infos)
                 {
-                    size_t index = std::distance(entities.begin(), it);
-                    RemoveEntityAt(index);
+                    columnIndices[info->type] = columns.size();
+                    columns.emplace_back(*info, resource);
+                    validTypes.insert(info->type);
                 }
             }
 
-            template <typename... Components>
-            std::tuple<Components&...> GetComponents(EntityID entity) 
+            const std::set<std::type_index>& GetComponentTypes() const
             {
-                size_t index = GetEntityIndex(entity);
-                return std::tie(GetComponentVector<Components>()[index]...);
+                return validTypes;
             }
 
-            template <typename Component>
-            Component* GetComponent(EntityID entity)
+            std::vector<const ComponentInfo*> GetComponentInfos() const
             {
-                size_t index = GetEntityIndex(entity);
+                std::vector<const ComponentInfo*> infos;
+                infos.reserve(columns.size());
 
-                if (!validTypes.contains(typeid(Component))) return nullptr;
+                for (const Column& column : columns) infos.push_back(&column.GetInfo());
 
-                return &GetComponentVector<Component>()[index];
+                return infos;
             }
 
-            void* GetComponent(EntityID entity, std::type_index typeIndex)
+            std::vector<Column>& GetColumns()
             {
-                size_t index = GetEntityIndex(entity);
+                return columns;
+            }
 
-                if (!components.contains(typeIndex)) return nullptr;
+            Column* TryGetColumn(std::type_index type)
+            {
+                auto it = columnIndices.find(type);
+                if (it == columnIndices.end()) return nullptr;
 
-                return static_cast<std::vector<std::byte>*>(components[typeIndex].data)->data() + components[typeIndex].componentSize * index;
+                return &columns[it->second];
             }
 
-            void DestroyComponent(EntityID entity, std::type_index typeIndex)
+            template <typename Component>
+            Column& GetColumn()
             {
-                size_t index = GetEntityIndex(entity);
+                Column* column = TryGetColumn(typeid(Component));
 
-                if (!components.contains(typeIndex)) return;
+                if (!column)
+                {
+                    throw std::runtime_error("Invalid component type for this archetype");
+                }
 
-                ComponentStore store = components[typeIndex];
-                store.destroy(static_cast<std::vector<std::byte>*>(store.data)->data() + store.componentSize * index);
+                return *column;
             }
 
-            std::vector<EntityID>& GetEntityVector()
+            template <typename Component>
+            Component* GetComponent(std::size_t row)
+            {
+                Column* column = TryGetColumn(typeid(Component));
+                if (!column) return nullptr;
+
+                return column->Data<Component>() + row;
+            }
+
+            std::pmr::vector<EntityID>& GetEntityVector()
             {
                 return entities;
             }
 
-            template <typename Component>
-            std::vector<Component>& GetComponentVector() 
+            std::size_t GetEntityCount() const
             {
-                std::type_index type = typeid(Component);
-                if (validTypes.find(type) == validTypes.end())
+                return entities.size();
+            }
+
+            ArchetypeMemoryStats GetMemoryStats() const
+            {
+                ArchetypeMemoryStats stats;
+                stats.entityCount = entities.size();
+                stats.bytesAllocated = entities.capacity() * sizeof(EntityID);
+                stats.bytesUsed = entities.size() * sizeof(EntityID);
+                stats.columns.reserve(columns.size());
+
+                for (const Column& column : columns)
                 {
-                    throw std::runtime_error("Invalid component type for this archetype");
+                    std::size_t size = column.GetInfo().size;
+                    stats.columns.push_back({ column.GetInfo().type, column.GetCapacity() * size, column.Size() * size });
+
+                    stats.bytesAllocated += stats.columns.back().bytesAllocated;
+                    stats.bytesUsed += stats.columns.back().bytesUsed;
                 }
 
-                if (components[type].data == nullptr)
+                return stats;
+            }
+
+            // Copies the entities and every changed column for rollback, unchanged ones share their last copy.
+            // reuse is an older copy of this archetype whose memory may be reused.
+            ArchetypeCopy Capture(ArchetypeCopy reuse)
+            {
+                if (entitiesModified || !entitiesCapture)
                 {
-                    components[type].data = new std::vector<Component>();
-                    components[type].componentSize = sizeof(Component);
+                    entitiesCapture.reset();
+
+                    std::shared_ptr<std::vector<EntityID>> copy = std::const_pointer_cast<std::vector<EntityID>>(std::move(reuse.entities));
+                    if (!copy || copy.use_count() != 1) copy = std::make_shared<std::vector<EntityID>>();
+
+                    copy->assign(entities.begin(), entities.end());
+
+                    entitiesCapture = std::move(copy);
+                    entitiesModified = false;
                 }
 
-                std::vector<Component>* vec = static_cast<std::vector<Component>*>(components[type].data);
+                ArchetypeCopy copy;
+                copy.entities = entitiesCapture;
+                copy.columns.reserve(columns.size());
+
+                for (std::size_t column = 0; column < columns.size(); column++)
+                {
+                    copy.columns.push_back(columns[column].Capture(column < reuse.columns.size() ? std::move(reuse.columns[column]) : nullptr));
+                }
 
-                return *vec;
+                return copy;
             }
 
-            ComponentStore& GetComponentStore(std::type_index type, size_t size) 
+            // True when restoring copy leaves the entity array as it is, a null copy matches an empty archetype.
+            bool EntitiesMatch(const ArchetypeCopy* copy) const
             {
-                if (validTypes.find(type) == validTypes.end()) 
+                if (!copy) return entities.empty();
+
+                return copy->entities == entitiesCapture && !entitiesModified;
+            }
+
+            // Returns to a copy from Capture, a null copy empties the archetype. Only changed columns are copied.
+            void Restore(const ArchetypeCopy* copy)
+            {
+                if (!EntitiesMatch(copy))
                 {
-                    throw std::runtime_error("Invalid component type for this archetype");
+                    if (copy) entities.assign(copy->entities->begin(), copy->entities->end());
+                    else entities.clear();
+
+                    entitiesCapture = copy ? copy->entities : nullptr;
+                    entitiesModified = !copy;
+                }
+
+                for (std::size_t column = 0; column < columns.size(); column++)
+                {
+                    columns[column].Restore(copy ? copy->columns[column] : nullptr);
+
+                    // A column that skipped a change to its row count would keep a stale copy here.
+                    assert(columns[column].Size() == entities.size());
+                }
+            }
+
+            // Appends entities with trivially copyable components copied from columnData, which holds one array per
+            // column in the order of GetColumns(). With adopt the arrays are used in place, see Column::Adopt, which
+            // needs the archetype to be empty. Returns the row of the first entity.
+            std::size_t AppendExternalRows(const EntityID* newEntities, std::size_t newCount, const void* const* columnData, bool adopt)
+            {
+                std::size_t firstRow = entities.size();
+                entitiesModified = true;
+                entities.insert(entities.end(), newEntities, newEntities + newCount);
+
+                for (std::size_t column = 0; column < columns.size(); column++)
+                {
+                    std::byte* source = static_cast<std::byte*>(const_cast<void*>(columnData[column]));
+
+                    if (adopt) columns[column].Adopt(source, newCount);
+                    else if (newCount > 0) std::memcpy(columns[column].Grow(newCount), source, newCount * columns[column].GetInfo().size);
+                }
+
+                return firstRow;
+            }
+
+            // Appends the entities with uninitialized components and returns the row of the first one.
+            std::size_t AppendEntities(const EntityID* newEntities, std::size_t newCount)
+            {
+                std::size_t firstRow = entities.size();
+                entitiesModified = true;
+
+                entities.insert(entities.end(), newEntities, newEntities + newCount);
+                for (Column& column : columns) column.Grow(newCount);
+
+                return firstRow;
+            }
+
+            void DestroyRow(std::size_t row)
+            {
+                for (Column& column : columns)
+                {
+                    if (!column.GetInfo().triviallyCopyable) column.GetInfo().destroy(column.Get(row));
                 }
+            }
 
-                if (components[type].data == nullptr) 
+            // Removes a row whose components were already relocated or destroyed by moving the last row into it.
+            // Returns true when another entity moved into the row.
+            bool RemoveRow(std::size_t row)
+            {
+                std::size_t last = entities.size() - 1;
+                entitiesModified = true;
+
+                for (Column& column : columns) column.FillFromBack(row);
+
+                entities[row] = entities[last];
+                entities.pop_back();
+
+                return row != last;
+            }
+
+            // Removes rows like RemoveRow, onMoved(entity, row) is called for every entity that changed row.
+            // The rows must be sorted in descending order so no pending row is moved.
+            template <typename F>
+            void RemoveRows(std::span<const std::size_t> descendingRows, F&& onMoved)
+            {
+                std::size_t remaining = entities.size() - descendingRows.size();
+
+                // Removing the tail needs no moves, which is the common case of an archetype emptying out.
+                if (!descendingRows.empty() && descendingRows.front() == entities.size() - 1 && descendingRows.back() == remaining)
                 {
-                    components[type].data = new std::vector<std::byte>();
-                    components[type].componentSize = size;
-                    static_cast<std::vector<std::byte>*>(components[type].data)->resize(size * entities.capacity());
+                    for (Column& column : columns) column.Truncate(remaining);
+                    entities.resize(remaining);
+                    entitiesModified = true;
+                    return;
                 }
 
-                return components[type];
+                for (std::size_t row : descendingRows)
+                {
+                    if (RemoveRow(row)) onMoved(entities[row], row);
+                }
             }
         };
 	}
-}
\ No newline at end of file
+}
@@ -1,35 +1,964 @@
 #pragma once
 #include "World.h"
 
+Weave::ECS::World::World(std::pmr::memory_resource* resource)
+	: memoryResource(resource), viewResource(std::pmr::get_default_resource()), entityRecords(resource) { }
+
+void Weave::ECS::World::SetViewResource(std::pmr::memory_resource* resource)
+{
+	viewResource = resource;
+}
+
 Weave::ECS::EntityID Weave::ECS::World::CreateEntity()
 {
-	if (!availableEntityIDs.empty())
-		return availableEntityIDs.extract(availableEntityIDs.begin()).value();
+	FlushReservedEntities();
 
-	return nextEntityID++;
+	return entityAllocator.Allocate();
 }
 
 void Weave::ECS::World::DeleteEntity(EntityID entity)
 {
+	FlushReservedEntities();
+
 	if (!IsEntityRegistered(entity))
 		throw std::logic_error("Entity is not registered.");
 
-	Archetype* archetype = entityToArchetype[entity];
+	if (EntityRecord* record = TryGetRecord(entity))
+	{
+		Archetype* archetype = record->archetype;
+		std::size_t row = record->row;
+
+		if (observers.IsActive())
+		{
+			for (const ComponentInfo* info : archetype->GetComponentInfos()) observers.Record(info->type, entity, true, false);
+		}
+
+		archetype->DestroyRow(row);
+		if (archetype->RemoveRow(row)) entityRecords[archetype->GetEntityVector()[row]].row = row;
+
+		*record = EntityRecord();
+		rowVersion++;
+	}
 
-	for (std::type_index componentType : archetype->GetComponentTypes())
+	for (std::pair<const std::type_index, std::unique_ptr<ISparseSet>>& pair : sparseComponents)
 	{
-		archetype->DestroyComponent(entity, componentType);
+		if (observers.IsActive() && pair.second->HasIndex(entity)) observers.Record(pair.first, entity, true, false);
+		pair.second->Delete(entity);
 	}
 
-	archetype->RemoveEntity(entity);
-	entityToArchetype.erase(entity);
-	availableEntityIDs.insert(entity);
+	hierarchy.Remove(entity);
+	entityAllocator.Free(entity);
 }
 
 bool Weave::ECS::World::IsEntityRegistered(Weave::ECS::EntityID entity) const
 {
-	if (entity > nextEntityID) return false;
-	if (availableEntityIDs.find(entity) != availableEntityIDs.end()) return false;
+	return entityAllocator.IsAlive(entity);
+}
+
+Weave::ECS::EntityID Weave::ECS::World::ReserveEntity()
+{
+	return entityAllocator.Reserve();
+}
+
+void Weave::ECS::World::FlushReservedEntities()
+{
+	if (entityAllocator.HasReserved()) entityAllocator.FlushReserved();
+}
+
+void Weave::ECS::World::SaveSnapshot(const std::string& path)
+{
+	FlushReservedEntities();
+
+	std::vector<SnapshotTable> tables;
+
+	for (const auto& [types, archetype] : archetypes)
+	{
+		if (archetype->GetEntityCount() == 0) continue;
+
+		SnapshotTable& table = tables.emplace_back();
+		table.entities = archetype->GetEntityVector();
+
+		for (Column& column : archetype->GetColumns())
+		{
+			table.infos.push_back(&column.GetInfo());
+			table.columns.push_back(column.Get(0));
+		}
+	}
+
+	for (const std::pair<const std::type_index, std::unique_ptr<ISparseSet>>& pair : sparseComponents)
+	{
+		if (pair.second->GetDenseIndexes().empty()) continue;
+
+		SnapshotTable& table = tables.emplace_back();
+		table.sparse = true;
+		table.entities = pair.second->GetDenseIndexes();
+		table.infos.push_back(GetSnapshotComponent(pair.first).info);
+		table.columns.push_back(pair.second->GetDenseData());
+	}
+
+	WriteSnapshot(path, entityAllocator.GetCapacity(), entityAllocator.GetFreeIDs(), tables);
+}
+
+void Weave::ECS::World::LoadSnapshot(const std::string& path, SnapshotLoadMode mode)
+{
+	std::shared_ptr<SnapshotFile> snapshot = SnapshotFile::Open(path);
+
+	Reset();
+	entityAllocator.Restore(snapshot->GetNextEntity(), snapshot->GetFreeIDs());
+	entityRecords.resize(snapshot->GetNextEntity());
+
+	bool adopted = false;
+	std::vector<const ComponentInfo*> tableInfos;
+	std::vector<const void*> tableColumns;
+
+	for (const SnapshotTable& table : snapshot->GetTables())
+	{
+		for (EntityID entity : table.entities)
+		{
+			if (!entityAllocator.IsAlive(entity)) throw std::runtime_error("Snapshot is truncated or corrupt.");
+		}
+
+		// Archetype tables restore their table components in bulk. Sparse tables come from sparse sets, possibly
+		// saved by the SparseSet backend, and their table components are added entity by entity.
+		tableInfos.clear();
+
+		for (std::size_t column = 0; column < table.infos.size(); column++)
+		{
+			const ComponentInfo* info = table.infos[column];
+			std::byte* values = static_cast<std::byte*>(const_cast<void*>(table.columns[column]));
+
+			if (info->storage == StorageType::Sparse)
+			{
+				GetSparseSet(*info).EmplaceRange(table.entities, values);
+			}
+			else if (table.sparse)
+			{
+				for (std::size_t row = 0; row < table.entities.size(); row++)
+				{
+					const ComponentOp op{ info, values + row * info->size };
+					ChangeTableComponents(table.entities[row], std::span<const ComponentOp>(&op, 1));
+				}
+			}
+			else
+			{
+				tableInfos.push_back(info);
+			}
+		}
+
+		if (tableInfos.empty()) continue;
+
+		Archetype& archetype = GetArchetype(tableInfos);
+		bool adopt = mode == SnapshotLoadMode::Adopt && archetype.GetEntityCount() == 0;
+		tableColumns.clear();
+
+		for (Column& column : archetype.GetColumns())
+		{
+			std::size_t index = 0;
+			while (table.infos[index] != &column.GetInfo()) index++;
+
+			tableColumns.push_back(table.columns[index]);
+			if (column.GetInfo().alignment > SnapshotFile::BlobAlignment) adopt = false;
+		}
+
+		std::size_t firstRow = archetype.AppendExternalRows(table.entities.data(), table.entities.size(), tableColumns.data(), adopt);
+
+		for (std::size_t row = 0; row < table.entities.size(); row++)
+		{
+			entityRecords[table.entities[row]] = { &archetype, firstRow + row };
+		}
+
+		adopted |= adopt;
+	}
+
+	if (adopted) adoptedSnapshots.push_back(std::move(snapshot));
+
+	observers.Discard();
+}
+
+Weave::ECS::RollbackSnapshot Weave::ECS::World::Snapshot()
+{
+	FlushReservedEntities();
+
+	RollbackFrame& frame = rollbackFrames[rollbackSequence % rollbackFrames.size()];
+
+	// The overwritten snapshot hands its copies to the new one, those no other snapshot shares are reused.
+	RollbackFrame previous = std::move(frame);
+	frame = RollbackFrame();
+
+	frame.entities = entityAllocator.Capture(std::move(previous.entities));
+	frame.hierarchy = hierarchy.Capture(std::move(previous.hierarchy));
+
+	for (const auto& [types, archetype] : archetypes)
+	{
+		ArchetypeCopy* reuse = previous.archetypes.Find(archetype.get());
+		frame.archetypes.Add(archetype.get(), archetype->Capture(reuse ? std::move(*reuse) : ArchetypeCopy()));
+	}
+
+	for (const std::pair<const std::type_index, std::unique_ptr<ISparseSet>>& pair : sparseComponents)
+	{
+		std::shared_ptr<const SparseSetCopy>* reuse = previous.sparseSets.Find(pair.second.get());
+		frame.sparseSets.Add(pair.second.get(), pair.second->Capture(reuse ? std::move(*reuse) : nullptr));
+	}
+
+	frame.archetypes.Sort();
+	frame.sparseSets.Sort();
+	frame.sequence = ++rollbackSequence;
+
+	return { frame.sequence };
+}
+
+void Weave::ECS::World::Restore(RollbackSnapshot snapshot)
+{
+	RollbackFrame& frame = GetRollbackFrame(snapshot);
+
+	FlushReservedEntities();
+	entityAllocator.Restore(frame.entities);
+	hierarchy.Restore(frame.hierarchy);
+
+	// Records of entities in archetypes whose entity array changes are cleared first and set once every
+	// archetype is restored, since entities may have moved between them.
+	restoredArchetypes.clear();
+
+	for (const auto& [types, archetype] : archetypes)
+	{
+		const ArchetypeCopy* copy = frame.archetypes.Find(archetype.get());
+
+		if (!archetype->EntitiesMatch(copy))
+		{
+			for (EntityID entity : archetype->GetEntityVector()) entityRecords[entity] = EntityRecord();
+			restoredArchetypes.push_back(archetype.get());
+		}
+
+		archetype->Restore(copy);
+	}
+
+	for (Archetype* archetype : restoredArchetypes)
+	{
+		std::pmr::vector<EntityID>& entities = archetype->GetEntityVector();
+		for (std::size_t row = 0; row < entities.size(); row++) GetRecord(entities[row]) = { archetype, row };
+	}
+
+	if (!restoredArchetypes.empty()) rowVersion++;
+
+	for (const std::pair<const std::type_index, std::unique_ptr<ISparseSet>>& pair : sparseComponents)
+	{
+		const std::shared_ptr<const SparseSetCopy>* copy = frame.sparseSets.Find(pair.second.get());
+		pair.second->Restore(copy ? *copy : nullptr);
+	}
+
+	observers.Discard();
+}
+
+std::vector<std::byte> Weave::ECS::World::ExtractDelta(RollbackSnapshot baseline, RollbackSnapshot target)
+{
+	const RollbackFrame* from = baseline.sequence != 0 ? &GetRollbackFrame(baseline) : nullptr;
+	const RollbackFrame& to = GetRollbackFrame(target);
+	const EntityAllocator::State& alive = *to.entities;
+
+	DeltaWriter writer;
+	writer.AddEntityChanges(from ? from->entities.get() : nullptr, alive);
+
+	// Rows that hold the same entity in both copies are compared column by column. Entities that changed row or
+	// archetype are matched up through where they were and where they are now.
+	struct Location
+	{
+		const ArchetypeCopy* copy;
+		std::size_t row;
+	};
+
+	std::unordered_map<EntityID, Location> before;
+	std::unordered_map<EntityID, Location> after;
+
+	for (const auto& [archetype, copy] : to.archetypes.entries)
+	{
+		const ArchetypeCopy* baselineCopy = from ? from->archetypes.Find(archetype) : nullptr;
+		const std::vector<EntityID>& entities = *copy.entities;
+
+		if (!baselineCopy)
+		{
+			for (std::size_t row = 0; row < entities.size(); row++) after[entities[row]] = { &copy, row };
+			continue;
+		}
+
+		const std::vector<EntityID>& baselineEntities = *baselineCopy->entities;
+		std::size_t commonRows = std::min(entities.size(), baselineEntities.size());
+
+		for (std::size_t column = 0; column < copy.columns.size(); column++)
+		{
+			const ColumnCopy& now = *copy.columns[column];
+			const ColumnCopy& was = *baselineCopy->columns[column];
+			if (&now == &was) continue;
+
+			ForEachChangedRow(entities.data(), baselineEntities.data(), static_cast<const std::byte*>(now.Get(0)), static_cast<const std::byte*>(was.Get(0)),
+				now.GetInfo().size, commonRows, [&](std::size_t row) { writer.Set(now.GetInfo(), entities[row], now.Get(row)); });
+		}
+
+		if (copy.entities == baselineCopy->entities) continue;
+
+		for (std::size_t row = 0; row < std::max(entities.size(), baselineEntities.size()); row++)
+		{
+			if (row < commonRows && entities[row] == baselineEntities[row]) continue;
+
+			if (row < baselineEntities.size()) before[baselineEntities[row]] = { baselineCopy, row };
+			if (row < entities.size()) after[entities[row]] = { &copy, row };
+		}
+	}
+
+	auto findColumn = [](const ArchetypeCopy& copy, const ComponentInfo& info) -> const ColumnCopy*
+		{
+			for (const std::shared_ptr<const ColumnCopy>& column : copy.columns)
+			{
+				if (&column->GetInfo() == &info) return column.get();
+			}
+
+			return nullptr;
+		};
+
+	for (const auto& [entity, now] : after)
+	{
+		auto it = before.find(entity);
+		const Location* was = it != before.end() ? &it->second : nullptr;
+
+		for (const std::shared_ptr<const ColumnCopy>& column : now.copy->columns)
+		{
+			const ComponentInfo& info = column->GetInfo();
+			const ColumnCopy* wasColumn = was ? findColumn(*was->copy, info) : nullptr;
+
+			if (!wasColumn || std::memcmp(wasColumn->Get(was->row), column->Get(now.row), info.size) != 0) writer.Set(info, entity, column->Get(now.row));
+		}
+
+		if (!was) continue;
+
+		for (const std::shared_ptr<const ColumnCopy>& column : was->copy->columns)
+		{
+			if (!findColumn(*now.copy, column->GetInfo())) writer.Remove(column->GetInfo(), entity);
+		}
+
+		before.erase(it);
+	}
+
+	// Entities left without table components, those destroyed lose them with the entity.
+	for (const auto& [entity, was] : before)
+	{
+		if (!alive.IsAlive(entity)) continue;
+
+		for (const std::shared_ptr<const ColumnCopy>& column : was.copy->columns) writer.Remove(column->GetInfo(), entity);
+	}
+
+	for (const auto& [sparseSet, copy] : to.sparseSets.entries)
+	{
+		const std::shared_ptr<const SparseSetCopy>* baselineCopy = from ? from->sparseSets.Find(sparseSet) : nullptr;
+		writer.AddSparseSetChanges(baselineCopy ? baselineCopy->get() : nullptr, *copy, alive);
+	}
+
+	return writer.Finish(baseline.sequence, target.sequence);
+}
+
+std::uint64_t Weave::ECS::World::ApplyDelta(std::span<const std::byte> delta)
+{
+	DeltaBatch batch(delta);
+
+	FlushReservedEntities();
+
+	for (EntityID entity : batch.GetSpawned()) entityAllocator.Claim(entity);
+
+	for (const EntityTransition& transition : batch.GetTransitions())
+	{
+		if (!IsEntityRegistered(transition.entity) || (transition.deleted && !transition.ops.empty()))
+			throw std::runtime_error("Delta does not match the world's entities.");
+	}
+
+	ApplyTransitions(batch.GetTransitions());
+
+	return batch.GetTarget();
+}
+
+Weave::ECS::World::RollbackFrame& Weave::ECS::World::GetRollbackFrame(RollbackSnapshot snapshot)
+{
+	RollbackFrame& frame = rollbackFrames[(snapshot.sequence - 1) % rollbackFrames.size()];
+
+	if (snapshot.sequence == 0 || frame.sequence != snapshot.sequence)
+		throw std::logic_error("Snapshot is no longer in the rollback ring.");
+
+	return frame;
+}
+
+void Weave::ECS::World::SetRollbackCapacity(std::size_t capacity)
+{
+	if (capacity == 0) throw std::invalid_argument("The rollback ring needs room for at least one snapshot.");
+
+	rollbackFrames.clear();
+	rollbackFrames.resize(capacity);
+}
+
+Weave::ISparseSet& Weave::ECS::World::GetSparseSet(const ComponentInfo& info)
+{
+	std::unique_ptr<ISparseSet>& sparseSet = sparseComponents[info.type];
+	if (!sparseSet) sparseSet = info.createSparseSet(memoryResource);
+
+	return *sparseSet;
+}
+
+void Weave::ECS::World::Reset()
+{
+	FlushReservedEntities();
+
+	cachedSource = nullptr;
+	cachedDestination = nullptr;
+	cachedOps.clear();
+
+	componentToArchetypes.clear();
+	archetypes.clear();
+	sparseComponents.clear();
+	entityRecords.clear();
+	adoptedSnapshots.clear();
+	hierarchy.Clear();
+	rowVersion++;
+
+	// Snapshots point at the storage that is cleared.
+	for (RollbackFrame& frame : rollbackFrames) frame = RollbackFrame();
+
+	entityAllocator.Restore(0, {});
+}
+
+Weave::ECS::WorldMemoryStats Weave::ECS::World::GetMemoryStats() const
+{
+	WorldMemoryStats stats;
+	stats.archetypes.reserve(archetypes.size());
+
+	for (const auto& [types, archetype] : archetypes)
+	{
+		stats.archetypes.push_back(archetype->GetMemoryStats());
+		if (stats.archetypes.back().entityCount == 0) stats.emptyArchetypes++;
+
+		stats.bytesAllocated += stats.archetypes.back().bytesAllocated;
+		stats.bytesUsed += stats.archetypes.back().bytesUsed;
+	}
+
+	stats.sparseSets.reserve(sparseComponents.size());
+
+	for (const std::pair<const std::type_index, std::unique_ptr<ISparseSet>>& pair : sparseComponents)
+	{
+		stats.sparseSets.push_back(pair.second->GetMemoryStats());
+		stats.bytesAllocated += stats.sparseSets.back().bytesAllocated;
+		stats.bytesUsed += stats.sparseSets.back().bytesUsed;
+	}
+
+	stats.entities.aliveEntities = entityAllocator.GetAliveCount();
+	stats.entities.freeIDs = entityAllocator.GetFreeCount();
+	stats.entities.bytesAllocated = entityAllocator.GetAllocatedBytes() + entityRecords.capacity() * sizeof(EntityRecord) + hierarchy.GetAllocatedBytes();
+	stats.bytesAllocated += stats.entities.bytesAllocated;
+
+	return stats;
+}
+
+void Weave::ECS::World::ApplyTransitions(std::span<const EntityTransition> transitions)
+{
+	pendingMoves.clear();
+	std::map<std::pair<Archetype*, Archetype*>, std::size_t> groups;
+
+	for (const EntityTransition& transition : transitions)
+	{
+		if (transition.deleted)
+		{
+			DeleteEntity(transition.entity);
+			continue;
+		}
+
+		if (transition.ops.empty()) continue;
+
+		EntityRecord* record = TryGetRecord(transition.entity);
+		Archetype* source = record ? record->archetype : nullptr;
+
+		if (observers.IsActive()) RecordComponentEvents(transition.entity, source, transition.ops);
+		ApplySparseOps(transition.entity, transition.ops);
+
+		Archetype* destination = GetDestinationArchetype(source, transition.ops);
+
+		if (destination == source)
+		{
+			OverwriteComponents(transition.entity, transition.ops);
+			continue;
+		}
+
+		// Groups are numbered in order of first appearance so the resulting row order does not depend on archetype addresses.
+		std::size_t group = !pendingMoves.empty() && pendingMoves.back().source == source && pendingMoves.back().destination == destination
+			? pendingMoves.back().group
+			: groups.try_emplace({ source, destination }, groups.size()).first->second;
+
+		pendingMoves.push_back({ source, destination, transition.entity, transition.ops, group });
+	}
+
+	std::stable_sort(pendingMoves.begin(), pendingMoves.end(), [](const PendingMove& a, const PendingMove& b) { return a.group < b.group; });
+
+	// MoveEntities reuses the scratch buffers, so the pending moves are taken out while they are applied.
+	std::vector<PendingMove> moves = std::move(pendingMoves);
+
+	for (std::size_t begin = 0; begin < moves.size();)
+	{
+		std::size_t end = begin + 1;
+		while (end < moves.size() && moves[end].group == moves[begin].group) end++;
+
+		MoveEntities(std::span<const PendingMove>(moves.data() + begin, end - begin));
+		begin = end;
+	}
+
+	pendingMoves = std::move(moves);
+}
+
+Weave::ECS::Archetype& Weave::ECS::World::GetArchetype(std::vector<const ComponentInfo*> infos)
+{
+	std::sort(infos.begin(), infos.end(), [](const ComponentInfo* a, const ComponentInfo* b) { return a->type < b->type; });
+
+	std::set<std::type_index> typeSet;
+
+	for (const ComponentInfo* info : infos)
+	{
+		typeSet.insert(info->type);
+	}
+
+	auto it = archetypes.find(typeSet);
+
+	if (it == archetypes.end())
+	{
+		auto archetype = std::make_unique<Archetype>(infos, memoryResource);
+		Archetype* archetypePtr = archetype.get();
+		archetypes.emplace(typeSet, std::move(archetype));
+
+		for (const auto& type : typeSet) {
+			componentToArchetypes[type].insert(archetypePtr);
+		}
+
+		return *archetypePtr;
+	}
+	return *it->second.get();
+}
+
+Weave::ECS::Archetype* Weave::ECS::World::GetDestinationArchetype(Archetype* source, std::span<const ComponentOp> ops)
+{
+	auto sameChange = [](const ComponentOp& a, const ComponentOp& b) { return a.info == b.info && !a.value == !b.value; };
+
+	if (source == cachedSource && std::equal(ops.begin(), ops.end(), cachedOps.begin(), cachedOps.end(), sameChange))
+		return cachedDestination;
+
+	cachedSource = source;
+	cachedOps.assign(ops.begin(), ops.end());
+	cachedDestination = FindDestinationArchetype(source, ops);
+
+	return cachedDestination;
+}
+
+Weave::ECS::Archetype* Weave::ECS::World::FindDestinationArchetype(Archetype* source, std::span<const ComponentOp> ops)
+{
+	std::vector<const ComponentInfo*> infos;
+	if (source) infos = source->GetComponentInfos();
+
+	bool changed = false;
+
+	for (const ComponentOp& op : ops)
+	{
+		if (op.info->storage == StorageType::Sparse) continue;
+
+		auto it = std::find(infos.begin(), infos.end(), op.info);
+
+		if (op.value && it == infos.end())
+		{
+			infos.push_back(op.info);
+			changed = true;
+		}
+		else if (!op.value && it != infos.end())
+		{
+			infos.erase(it);
+			changed = true;
+		}
+	}
+
+	if (!changed) return source;
+	if (infos.empty()) return nullptr;
+
+	return &GetArchetype(std::move(infos));
+}
+
+void Weave::ECS::World::ApplySparseOps(EntityID entity, std::span<const ComponentOp> ops)
+{
+	for (const ComponentOp& op : ops)
+	{
+		if (op.info->storage != StorageType::Sparse) continue;
+
+		auto it = sparseComponents.find(op.info->type);
+
+		if (op.value)
+		{
+			if (it == sparseComponents.end()) it = sparseComponents.emplace(op.info->type, op.info->createSparseSet(memoryResource)).first;
+			it->second->Emplace(entity, op.value);
+		}
+		else if (it != sparseComponents.end())
+		{
+			it->second->Delete(entity);
+		}
+	}
+}
+
+void Weave::ECS::World::RecordComponentEvents(EntityID entity, Archetype* source, std::span<const ComponentOp> ops)
+{
+	for (const ComponentOp& op : ops)
+	{
+		bool had;
+
+		if (op.info->storage == StorageType::Sparse)
+		{
+			auto it = sparseComponents.find(op.info->type);
+			had = it != sparseComponents.end() && it->second->HasIndex(entity);
+		}
+		else
+		{
+			had = source && source->TryGetColumn(op.info->type);
+		}
+
+		observers.Record(op.info->type, entity, had, op.value != nullptr);
+	}
+}
+
+void Weave::ECS::World::OverwriteComponents(EntityID entity, std::span<const ComponentOp> ops)
+{
+	EntityRecord* record = TryGetRecord(entity);
+	if (!record) return;
+
+	for (const ComponentOp& op : ops)
+	{
+		if (!op.value || op.info->storage == StorageType::Sparse) continue;
+
+		Column* column = record->archetype->TryGetColumn(op.info->type);
+		if (!column) continue;
+
+		void* component = column->Get(record->row);
+		op.info->destroy(component);
+		op.info->moveConstruct(component, op.value);
+	}
+}
+
+void Weave::ECS::World::ChangeTableComponents(EntityID entity, std::span<const ComponentOp> ops)
+{
+	EntityRecord* record = TryGetRecord(entity);
+	Archetype* source = record ? record->archetype : nullptr;
+	Archetype* destination = GetDestinationArchetype(source, ops);
+
+	if (observers.IsActive()) RecordComponentEvents(entity, source, ops);
+
+	if (destination == source)
+	{
+		OverwriteComponents(entity, ops);
+		return;
+	}
+
+	PendingMove move{ source, destination, entity, ops, 0 };
+	MoveEntities(std::span<const PendingMove>(&move, 1));
+}
+
+void Weave::ECS::World::MoveEntities(std::span<const PendingMove> moves)
+{
+	Archetype* source = moves.front().source;
+	Archetype* destination = moves.front().destination;
+
+	auto findValue = [](std::span<const ComponentOp> ops, std::type_index type) -> void*
+		{
+			for (const ComponentOp& op : ops)
+			{
+				if (op.info->type == type) return op.value;
+			}
+
+			return nullptr;
+		};
+
+	movedEntities.clear();
+	movedRows.clear();
+	rowVersion++;
+
+	for (const PendingMove& move : moves)
+	{
+		movedEntities.push_back(move.entity);
+		if (source) movedRows.push_back(GetRecord(move.entity).row);
+		else GetRecord(move.entity);
+	}
+
+	if (destination)
+	{
+		std::size_t firstRow = destination->AppendEntities(movedEntities.data(), movedEntities.size());
+
+		for (Column& column : destination->GetColumns())
+		{
+			const ComponentInfo& info = column.GetInfo();
+			Column* sourceColumn = source ? source->TryGetColumn(info.type) : nullptr;
+
+			for (std::size_t index = 0; index < moves.size();)
+			{
+				void* target = column.Get(firstRow + index);
+
+				if (void* value = findValue(moves[index].ops, info.type))
+				{
+					if (sourceColumn) info.destroy(sourceColumn->Get(movedRows[index]));
+					info.moveConstruct(target, value);
+					index++;
+					continue;
+				}
+
+				// Consecutive source rows of a trivially copyable component are copied with a single memcpy.
+				std::size_t end = index + 1;
+
+				if (info.triviallyCopyable)
+				{
+					while (end < moves.size() && movedRows[end] == movedRows[end - 1] + 1 && !findValue(moves[end].ops, info.type)) end++;
+
+					std::memcpy(target, sourceColumn->Get(movedRows[index]), (end - index) * info.size);
+				}
+				else
+				{
+					info.Relocate(target, sourceColumn->Get(movedRows[index]));
+				}
+
+				index = end;
+			}
+		}
+
+		for (std::size_t index = 0; index < moves.size(); index++)
+		{
+			entityRecords[movedEntities[index]] = { destination, firstRow + index };
+		}
+	}
+	else
+	{
+		for (EntityID entity : movedEntities) entityRecords[entity] = EntityRecord();
+	}
+
+	if (!source) return;
+
+	for (Column& column : source->GetColumns())
+	{
+		const ComponentInfo& info = column.GetInfo();
+		if (info.triviallyCopyable || (destination && destination->TryGetColumn(info.type))) continue;
+
+		for (std::size_t row : movedRows) info.destroy(column.Get(row));
+	}
+
+	std::sort(movedRows.begin(), movedRows.end(), std::greater<std::size_t>());
+	source->RemoveRows(movedRows, [&](EntityID entity, std::size_t row) { entityRecords[entity].row = row; });
+}
+
+void Weave::ECS::World::SetParent(EntityID child, EntityID parent)
+{
+	FlushReservedEntities();
+
+	if (!IsEntityRegistered(child) || !IsEntityRegistered(parent))
+		throw std::logic_error("Entity is not registered.");
+
+	hierarchy.SetParent(child, parent);
+}
+
+void Weave::ECS::World::RemoveParent(EntityID child)
+{
+	hierarchy.RemoveParent(child);
+}
 
-	return true;
-}
\ No newline at end of file
+Weave::ECS::EntityID Weave::ECS::World::GetParent(EntityID entity) const
+{
+	return hierarchy.GetParent(entity);
+}
+
+Weave::ECS::Hierarchy::Children Weave::ECS::World::GetChildren(EntityID entity) const
+{
+	return hierarchy.GetChildren(entity);
+}
+
+void Weave::ECS::World::UpdateHierarchyLayout()
+{
+	HierarchyLayout& layout = hierarchyLayout;
+	if (layout.hierarchyVersion == hierarchy.GetVersion() && layout.rowVersion == rowVersion) return;
+
+	HierarchyOrder& order = layout.order;
+	if (layout.hierarchyVersion != hierarchy.GetVersion()) hierarchy.BuildOrder(order);
+
+	layout.hierarchyVersion = hierarchy.GetVersion();
+	layout.rowVersion = rowVersion;
+
+	std::size_t count = order.entities.size();
+	layout.records.resize(count);
+
+	for (std::size_t index = 0; index < count; index++)
+	{
+		EntityRecord* record = TryGetRecord(order.entities[index]);
+		layout.records[index] = record ? *record : EntityRecord();
+	}
+
+	auto storedBefore = [&](std::size_t a, std::size_t b)
+		{
+			const EntityRecord& first = layout.records[a];
+			const EntityRecord& second = layout.records[b];
+
+			if (first.archetype != second.archetype) return std::less<Archetype*>()(first.archetype, second.archetype);
+			if (first.row != second.row) return first.row < second.row;
+
+			return order.entities[a] < order.entities[b];
+		};
+
+	// Adding entities leaves the rows of others alone, so after the first sort most refreshes find every depth sorted.
+	std::vector<std::size_t> permutation(count);
+	std::iota(permutation.begin(), permutation.end(), 0);
+
+	bool sorted = true;
+
+	for (std::size_t depth = 0; depth + 1 < order.levels.size(); depth++)
+	{
+		auto begin = permutation.begin() + order.levels[depth];
+		auto end = permutation.begin() + order.levels[depth + 1];
+
+		if (std::is_sorted(begin, end, storedBefore)) continue;
+
+		std::sort(begin, end, storedBefore);
+		sorted = false;
+	}
+
+	if (sorted) return;
+
+	std::vector<std::size_t> positions(count);
+	for (std::size_t index = 0; index < count; index++) positions[permutation[index]] = index;
+
+	HierarchyOrder sortedOrder;
+	sortedOrder.entities.resize(count);
+	sortedOrder.parents.resize(count);
+	sortedOrder.levels = std::move(order.levels);
+
+	std::vector<EntityRecord> sortedRecords(count);
+
+	for (std::size_t index = 0; index < count; index++)
+	{
+		std::size_t source = permutation[index];
+		std::size_t parent = order.parents[source];
+
+		sortedOrder.entities[index] = order.entities[source];
+		sortedOrder.parents[index] = parent != NoEntity ? positions[parent] : NoEntity;
+		sortedRecords[index] = layout.records[source];
+	}
+
+	order = std::move(sortedOrder);
+	layout.records = std::move(sortedRecords);
+}
+
+void Weave::ECS::World::RemoveObserver(ObserverID observer)
+{
+	observers.Remove(observer);
+}
+
+void Weave::ECS::World::NotifyObservers()
+{
+	observers.Notify(*this);
+}
+
+void Weave::ECS::World::AddDynamicComponent(EntityID entity, ComponentID component, const void* value)
+{
+	if (!IsEntityRegistered(entity))
+		throw std::logic_error("Entity is not registered.");
+
+	const ComponentInfo& info = RuntimeComponents::Get().GetInfo(component);
+	ComponentValue copy(info, memoryResource, value);
+
+	if (info.storage == StorageType::Sparse)
+	{
+		ISparseSet& sparseSet = GetSparseSet(info);
+		if (observers.IsActive()) observers.Record(info.type, entity, sparseSet.HasIndex(entity), true);
+
+		sparseSet.Emplace(entity, copy.Get());
+		return;
+	}
+
+	const ComponentOp op{ &info, copy.Get() };
+	ChangeTableComponents(entity, std::span<const ComponentOp>(&op, 1));
+}
+
+void Weave::ECS::World::RemoveDynamicComponent(EntityID entity, ComponentID component)
+{
+	if (!IsEntityRegistered(entity))
+		throw std::logic_error("Entity is not registered.");
+
+	const ComponentInfo& info = RuntimeComponents::Get().GetInfo(component);
+
+	if (info.storage == StorageType::Sparse)
+	{
+		auto it = sparseComponents.find(info.type);
+		if (it == sparseComponents.end()) return;
+
+		if (observers.IsActive()) observers.Record(info.type, entity, it->second->HasIndex(entity), false);
+		it->second->Delete(entity);
+		return;
+	}
+
+	const ComponentOp op{ &info, nullptr };
+	ChangeTableComponents(entity, std::span<const ComponentOp>(&op, 1));
+}
+
+void* Weave::ECS::World::TryGetDynamicComponent(EntityID entity, ComponentID component)
+{
+	const ComponentInfo& info = RuntimeComponents::Get().GetInfo(component);
+
+	if (info.storage == StorageType::Sparse)
+	{
+		auto it = sparseComponents.find(info.type);
+		return it != sparseComponents.end() ? it->second->TryGet(entity) : nullptr;
+	}
+
+	EntityRecord* record = TryGetRecord(entity);
+	if (!record) return nullptr;
+
+	Column* column = record->archetype->TryGetColumn(info.type);
+	return column ? column->Get(record->row) : nullptr;
+}
+
+Weave::ECS::DynamicView Weave::ECS::World::GetDynamicView(std::span<const ComponentID> components)
+{
+	if (components.empty()) throw std::invalid_argument("A dynamic view needs at least one component.");
+
+	std::pmr::vector<const ComponentInfo*> infos(viewResource);
+	std::pmr::vector<std::size_t> strides(viewResource);
+
+	for (ComponentID component : components)
+	{
+		const ComponentInfo& info = RuntimeComponents::Get().GetInfo(component);
+		if (info.storage == StorageType::Sparse) throw std::invalid_argument("Dynamic views only cover components stored in archetype tables.");
+
+		infos.push_back(&info);
+		strides.push_back(info.size);
+	}
+
+	DynamicView view(strides, viewResource);
+
+	// The archetypes of the component found in the fewest, the others are looked up in each of them.
+	const std::set<Archetype*>* candidates = nullptr;
+
+	for (const ComponentInfo* info : infos)
+	{
+		auto it = componentToArchetypes.find(info->type);
+		if (it == componentToArchetypes.end()) return view;
+
+		if (!candidates || it->second.size() < candidates->size()) candidates = &it->second;
+	}
+
+	std::pmr::vector<std::byte*> columns(infos.size(), nullptr, viewResource);
+
+	for (Archetype* archetype : *candidates)
+	{
+		if (archetype->GetEntityCount() == 0) continue;
+
+		bool complete = true;
+
+		for (std::size_t index = 0; index < infos.size() && complete; index++)
+		{
+			Column* column = archetype->TryGetColumn(infos[index]->type);
+
+			complete = column != nullptr;
+			if (column) columns[index] = column->Data<std::byte>();
+		}
+
+		if (complete) view.AddChunk(archetype->GetEntityVector().data(), archetype->GetEntityCount(), columns);
+	}
+
+	return view;
+}
@@ -11,20 +11,51 @@
 #include <utility>
 #include <iostream>
 #include <functional>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <memory_resource>
+#include <mutex>
+#include <numeric>
+#include "ComponentTraits.h"
+#include "ComponentInfo.h"
+#include "EntityAllocator.h"
+#include "MemoryStats.h"
+#include "Snapshot.h"
+#include "Rollback.h"
+#include "Delta.h"
+#include "MemoryResource.h"
+#include "Hierarchy.h"
+#include "ComponentObservers.h"
+#include "RuntimeComponents.h"
 
 namespace Weave
 {
     namespace ECS
     {
+        // A contiguous range of rows within one archetype of a view.
+        struct ViewChunk
+        {
+            std::size_t view;
+            std::size_t begin;
+            std::size_t end;
+        };
+
+        // Scratch of a view lives in the World's view resource, see World::SetViewResource.
         template <typename... Components>
         class WorldView
         {
         private:
-            std::vector<ArchetypeView<Components...>> archetypeViews;
-            std::vector<size_t> cumulativeSizes;
+            std::pmr::vector<ArchetypeView<Components...>> archetypeViews;
+            std::pmr::vector<size_t> cumulativeSizes;
+
+            // Backing storage for views filtered by sparse components, the archetype views point into these.
+            std::pmr::vector<std::size_t> matchingRows;
+            std::pmr::vector<EntityID> sparseEntities;
 
         public:
-            WorldView(std::vector<ArchetypeView<Components...>> views) : archetypeViews(std::move(views))
+            WorldView(std::pmr::vector<ArchetypeView<Components...>> views, std::pmr::vector<std::size_t> rows = {}, std::pmr::vector<EntityID> entities = {})
+                : archetypeViews(std::move(views)), cumulativeSizes(archetypeViews.get_allocator()), matchingRows(std::move(rows)), sparseEntities(std::move(entities))
             {
                 cumulativeSizes.reserve(archetypeViews.size());
                 size_t total = 0;
@@ -35,11 +66,29 @@ namespace Weave
                 }
             }
 
+            WorldView(const WorldView&) = delete;
+            WorldView& operator=(const WorldView&) = delete;
+
+            WorldView(WorldView&&) = default;
+
+            // Views from different resources would copy their rows member by member, leaving the archetype views
+            // pointing at the old ones, so the view is rebuilt by moving instead.
+            WorldView& operator=(WorldView&& other) noexcept
+            {
+                if (this != &other)
+                {
+                    std::destroy_at(this);
+                    std::construct_at(this, std::move(other));
+                }
+
+                return *this;
+            }
+
             class Iterator
             {
             private:
                 using ArchetypeIterator = typename ArchetypeView<Components...>::Iterator;
-                std::vector<ArchetypeView<Components...>>* archetypeViews;
+                std::pmr::vector<ArchetypeView<Components...>>* archetypeViews;
                 size_t currentArchetypeIndex;
                 ArchetypeIterator currentIterator;
 
@@ -62,7 +111,7 @@ namespace Weave
                 }
 
             public:
-                Iterator(std::vector<ArchetypeView<Components...>>* views, size_t archetypeIndex, const ArchetypeIterator& iterator)
+                Iterator(std::pmr::vector<ArchetypeView<Components...>>* views, size_t archetypeIndex, const ArchetypeIterator& iterator)
                     : archetypeViews(views), currentArchetypeIndex(archetypeIndex), currentIterator(iterator)
                 {
                     AdvanceToNextValidArchetype();
@@ -99,7 +148,7 @@ namespace Weave
             Iterator end()
             {
                 if (archetypeViews.empty())
-                    return Iterator(&archetypeViews, 0, typename ArchetypeView<Components...>::Iterator(0, nullptr, {}));
+                    return Iterator(&archetypeViews, 0, typename ArchetypeView<Components...>::Iterator(0, nullptr));
 
                 return Iterator(&archetypeViews, archetypeViews.size(), archetypeViews.back().end());
             }
@@ -124,6 +173,36 @@ namespace Weave
                 if (cumulativeSizes.empty()) return 0;
                 return cumulativeSizes.back();
             }
+
+            // Splits the view along archetype boundaries, only archetypes larger than maxChunkSize are subdivided.
+            std::vector<ViewChunk> Partition(std::size_t maxChunkSize) const
+            {
+                std::vector<ViewChunk> chunks;
+
+                for (std::size_t view = 0; view < archetypeViews.size(); view++)
+                {
+                    std::size_t count = archetypeViews[view].GetEntityCount();
+
+                    for (std::size_t begin = 0; begin < count; begin += maxChunkSize)
+                    {
+                        chunks.push_back({ view, begin, std::min(count, begin + maxChunkSize) });
+                    }
+                }
+
+                return chunks;
+            }
+
+            template <typename F>
+            void ForEach(const ViewChunk& chunk, F&& fn) const
+            {
+                archetypeViews[chunk.view].ForEach(chunk.begin, chunk.end, fn);
+            }
+
+            template <typename F>
+            void ForEach(F&& fn) const
+            {
+                for (const ArchetypeView<Components...>& view : archetypeViews) view.ForEach(0, view.GetEntityCount(), fn);
+            }
         };
 
         class World;
@@ -131,99 +210,360 @@ namespace Weave
         class World
         {
         private:
-            EntityID nextEntityID = 0;
-            std::set<EntityID> availableEntityIDs;
+            struct EntityRecord
+            {
+                Archetype* archetype = nullptr;
+                std::size_t row = 0;
+            };
+
+            // An entity leaving source for destination, ops hold the values of the components it gains.
+            struct PendingMove
+            {
+                Archetype* source;
+                Archetype* destination;
+                EntityID entity;
+                std::span<const ComponentOp> ops;
+                std::size_t group;
+            };
+
+            // One snapshot of the rollback ring. Storage created after the snapshot has no copy and is emptied on restore.
+            struct RollbackFrame
+            {
+                std::uint64_t sequence = 0;
+                std::shared_ptr<const EntityAllocator::State> entities;
+                std::shared_ptr<const Hierarchy::State> hierarchy;
+                RollbackCopies<Archetype, ArchetypeCopy> archetypes;
+                RollbackCopies<ISparseSet, std::shared_ptr<const SparseSetCopy>> sparseSets;
+            };
+
+            // Columns, entity arrays, records and sparse sets allocate from memoryResource, views from viewResource.
+            std::pmr::memory_resource* memoryResource;
+            std::pmr::memory_resource* viewResource;
+
+            // Snapshots whose memory adopted columns point into, declared first so they are unmapped last.
+            std::vector<std::shared_ptr<SnapshotFile>> adoptedSnapshots;
 
-            std::map<EntityID, Archetype*> entityToArchetype;
+            EntityAllocator entityAllocator;
+
+            std::pmr::vector<EntityRecord> entityRecords;
             std::map<std::type_index, std::set<Archetype*>> componentToArchetypes;
             std::map<std::set<std::type_index>, std::unique_ptr<Archetype>> archetypes;
 
-            std::map<std::type_index, std::size_t> componentSizes;
+            std::unordered_map<std::type_index, std::unique_ptr<ISparseSet>> sparseComponents;
 
-            template <typename... Components>
-            Archetype& GetArchetype()
+            Hierarchy hierarchy;
+            ComponentObservers observers;
+
+            // Incremented whenever entities may have changed archetype or row.
+            std::uint64_t rowVersion = 0;
+
+            // The hierarchy's depth order with every depth sorted by archetype and row, so hierarchy views walk the
+            // columns forward. Refreshed when the hierarchy or any row changed, hierarchyMutex guards it.
+            struct HierarchyLayout
             {
-                std::set<ComponentData> typeSet;
+                std::uint64_t hierarchyVersion = std::numeric_limits<std::uint64_t>::max();
+                std::uint64_t rowVersion = 0;
+                HierarchyOrder order;
+                std::vector<EntityRecord> records;
+            };
+
+            HierarchyLayout hierarchyLayout;
+            std::mutex hierarchyMutex;
 
-                (typeSet.insert(ComponentData::GetComponentData<Components>()), ...);
+            // Scratch buffers reused by batched moves.
+            std::vector<PendingMove> pendingMoves;
+            std::vector<EntityID> movedEntities;
+            std::vector<std::size_t> movedRows;
 
-                return GetArchetype(typeSet);
+            std::vector<RollbackFrame> rollbackFrames = std::vector<RollbackFrame>(8);
+            std::uint64_t rollbackSequence = 0;
+            std::vector<Archetype*> restoredArchetypes;
+
+            // Last destination lookup, consecutive transitions usually repeat it.
+            Archetype* cachedSource = nullptr;
+            Archetype* cachedDestination = nullptr;
+            std::vector<ComponentOp> cachedOps;
+
+            EntityRecord* TryGetRecord(EntityID entity)
+            {
+                if (entity >= entityRecords.size() || !entityRecords[entity].archetype) return nullptr;
+                return &entityRecords[entity];
+            }
+
+            EntityRecord& GetRecord(EntityID entity)
+            {
+                if (entity >= entityRecords.size()) entityRecords.resize(entity + 1);
+                return entityRecords[entity];
             }
 
-            Archetype& GetArchetype(const std::set<ComponentData> dataSet)
+            template <typename Component>
+            SparseSet<Component>& GetSparseSet()
             {
-                std::set<std::type_index> typeSet;
+                auto it = sparseComponents.find(typeid(Component));
 
-                for (ComponentData data : dataSet)
+                if (it == sparseComponents.end())
                 {
-                    typeSet.insert(data.index);
+                    it = sparseComponents.emplace(typeid(Component), std::make_unique<SparseSet<Component>>(memoryResource)).first;
                 }
 
-                auto it = archetypes.find(typeSet);
+                return static_cast<SparseSet<Component>&>(*it->second);
+            }
 
-                if (it == archetypes.end())
-                {
-                    auto archetype = std::make_unique<Archetype>(dataSet);
-                    archetypes.emplace(typeSet, std::move(archetype));
-                    Archetype* archetypePtr = archetypes[typeSet].get();
+            template <typename Component>
+            SparseSet<Component>* TryGetSparseSet()
+            {
+                auto it = sparseComponents.find(typeid(Component));
 
-                    for (const auto& type : typeSet) {
-                        componentToArchetypes[type].insert(archetypePtr);
-                    }
+                if (it == sparseComponents.end()) return nullptr;
 
-                    return *archetypePtr;
-                }
-                return *it->second.get();
+                return static_cast<SparseSet<Component>*>(it->second.get());
+            }
+
+            template <typename Component>
+            static auto KeepTableComponent(Component& component)
+            {
+                if constexpr (SparseComponent<Component>) return std::tuple<>();
+                else return std::tuple<Component>(std::move(component));
             }
 
             template <typename... Components>
-            void TransferEntity(EntityID entity, Archetype* newArchetype, Archetype* oldArchetype, Components&&... newComponents)
+            using TableComponentTuple = decltype(std::tuple_cat(std::declval<std::conditional_t<SparseComponent<Components>, std::tuple<>, std::tuple<Components>>>()...));
+
+            template <typename Component>
+            SparseSet<Component>* GetQuerySparseSet()
             {
-                if (!oldArchetype)
-                {
-                    newArchetype->AddEntity(entity, std::forward<Components>(newComponents)...);
-                    entityToArchetype[entity] = newArchetype;
-                    return;
-                }
+                if constexpr (SparseComponent<Component>) return TryGetSparseSet<Component>();
+                else return nullptr;
+            }
 
-                newArchetype->AddEntity(entity, std::forward<Components>(newComponents)...);
+            template <typename Component>
+            ComponentSource<Component> GetComponentSource(Archetype* archetype, SparseSet<Component>* sparseSet)
+            {
+                if constexpr (SparseComponent<Component>) return sparseSet;
+                else return archetype->GetColumn<Component>().template Data<Component>();
+            }
 
-                std::size_t newEntityIndex = newArchetype->GetEntityVector().size() - 1;
+            // Points columns at the table components of the query in archetype, false when one of them is missing.
+            template <typename... QueryComponents>
+            static bool GetQueryColumns(Archetype* archetype, std::tuple<QueryComponents*...>& columns)
+            {
+                return ([&]<typename T>(T*) {
+                    if constexpr (SparseComponent<T>) return true;
+                    else
+                    {
+                        Column* column = archetype ? archetype->TryGetColumn(typeid(T)) : nullptr;
+                        if (!column) return false;
 
-                std::set<std::type_index> newTypes = newArchetype->GetComponentTypes();
+                        std::get<T*>(columns) = column->template Data<T>();
+                        return true;
+                    }
+                }(static_cast<QueryComponents*>(nullptr)) && ...);
+            }
 
-                for (std::type_index typeIndex : oldArchetype->GetComponentTypes())
-                {
-                    if (!newTypes.contains(typeIndex)) continue;
+            template <typename... Components>
+            static bool HasSparseComponents(const std::tuple<SparseSet<Components>*...>& sparseSets, EntityID entity)
+            {
+                return ([&]<typename T>(T*) {
+                    if constexpr (SparseComponent<T>) return std::get<SparseSet<T>*>(sparseSets)->HasIndex(entity);
+                    else return true;
+                }(static_cast<Components*>(nullptr)) && ...);
+            }
 
-                    std::size_t typeSize = componentSizes[typeIndex];
+            Archetype& GetArchetype(std::vector<const ComponentInfo*> infos);
+            Archetype* GetDestinationArchetype(Archetype* source, std::span<const ComponentOp> ops);
+            Archetype* FindDestinationArchetype(Archetype* source, std::span<const ComponentOp> ops);
 
-                    void* oldComponentPtr = oldArchetype->GetComponent(entity, typeIndex);
-                    void* newComponentPtr = static_cast<std::vector<std::byte>*>(newArchetype->GetComponentStore(typeIndex, typeSize).data)->data() + newEntityIndex * typeSize;
+            void ApplySparseOps(EntityID entity, std::span<const ComponentOp> ops);
 
-                    std::memcpy(newComponentPtr, oldComponentPtr, typeSize);
-                }
+            // Records the observer events of ops about to be applied to an entity in source.
+            void RecordComponentEvents(EntityID entity, Archetype* source, std::span<const ComponentOp> ops);
+            void OverwriteComponents(EntityID entity, std::span<const ComponentOp> ops);
+            void ChangeTableComponents(EntityID entity, std::span<const ComponentOp> ops);
 
-                oldArchetype->RemoveEntity(entity);
-                entityToArchetype[entity] = newArchetype;
-            }
+            // Moves entities that share a source and destination archetype one column at a time.
+            void MoveEntities(std::span<const PendingMove> moves);
+
+            ISparseSet& GetSparseSet(const ComponentInfo& info);
+            void Reset();
+
+            // Throws when the snapshot is no longer in the rollback ring.
+            RollbackFrame& GetRollbackFrame(RollbackSnapshot snapshot);
+
+            // Brings hierarchyLayout up to date, hierarchyMutex must be held.
+            void UpdateHierarchyLayout();
 
         public:
+            // The resource must outlive the world. It is only used by structural changes, which never run in parallel,
+            // so it needn't be thread safe: ChunkPool and HugePageResource both work. See also SetViewResource.
+            explicit World(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+            // Resource the scratch of views is allocated from, std::pmr::get_default_resource() by default. Systems
+            // running in parallel build views at the same time, so it must be thread safe, which rules out ChunkPool.
+            // A FrameArena makes building views nearly free, reset it once the views of a frame are gone.
+            void SetViewResource(std::pmr::memory_resource* resource);
+
             EntityID CreateEntity();
             void DeleteEntity(EntityID entity);
 
+            // Returns an ID that is usable in buffered commands right away, safe to call from any thread while systems run.
+            // The entity becomes alive on the next FlushReservedEntities, which CommandBuffer::Flush and CreateEntity call.
+            EntityID ReserveEntity();
+            void FlushReservedEntities();
+
             bool IsEntityRegistered(EntityID entity) const;
 
+            // Walks every archetype and sparse set, meant for diagnostics rather than every frame.
+            WorldMemoryStats GetMemoryStats() const;
+
+            // Saves every entity and component, all component types must be registered with the ComponentRegistry.
+            void SaveSnapshot(const std::string& path);
+
+            // Replaces the world's contents with a snapshot. Each archetype is restored with one copy per column,
+            // or with SnapshotLoadMode::Adopt without copying at all.
+            void LoadSnapshot(const std::string& path, SnapshotLoadMode mode = SnapshotLoadMode::Adopt);
+
+            // Saves the world into the rollback ring, overwriting the oldest snapshot once it is full. Columns, sparse
+            // sets and entity arrays that haven't changed since they were last captured or restored are shared with
+            // the snapshot before, so the cost follows the data that changed. Any non-const access to a column counts
+            // as a change, and views or component pointers taken before the snapshot must not be written through after it.
+            RollbackSnapshot Snapshot();
+
+            // Returns the world to a snapshot that is still in the ring, only storage that changed since is copied
+            // back. Throws when the snapshot was overwritten. Later snapshots stay valid.
+            void Restore(RollbackSnapshot snapshot);
+
+            // Number of snapshots the ring holds, 8 by default. Drops every snapshot taken so far.
+            void SetRollbackCapacity(std::size_t capacity);
+
+            // Encodes what changed from baseline to target, both snapshots in the ring, for replication. A default
+            // constructed baseline stands for an empty world. Only archetypes and sparse sets whose copies differ
+            // between the two are compared, so the cost follows what changed. Every component type must be
+            // registered with the ComponentRegistry.
+            std::vector<std::byte> ExtractDelta(RollbackSnapshot baseline, RollbackSnapshot target);
+
+            // Applies a delta to a world that mirrors the sender's entity IDs and is at the delta's baseline, all
+            // entities moving between the same archetypes are moved together. Returns the target snapshot's
+            // sequence, to acknowledge as the next baseline.
+            std::uint64_t ApplyDelta(std::span<const std::byte> delta);
+
+            // Applies the net structural change of many entities at once. Entities must be unique, those
+            // moving between the same pair of archetypes are moved together.
+            void ApplyTransitions(std::span<const EntityTransition> transitions);
+
+            // Observers get the entities that gained, lost or overwrote a component of the type, batched per type and
+            // event and delivered by NotifyObservers, which CommandBuffer::Flush calls. Loading and restoring
+            // snapshots isn't observed and drops the events not delivered yet.
             template <typename Component>
-            Component* TryGetComponent(EntityID entity)
+            ObserverID OnAdd(ComponentObserver observer)
             {
-                if (!entityToArchetype.contains(entity)) return nullptr;
+                return observers.Add(typeid(Component), ComponentEvent::Add, std::move(observer));
+            }
 
-                Archetype* entityArchetype = entityToArchetype[entity];
+            template <typename Component>
+            ObserverID OnRemove(ComponentObserver observer)
+            {
+                return observers.Add(typeid(Component), ComponentEvent::Remove, std::move(observer));
+            }
 
-                if (!entityArchetype->GetComponentTypes().contains(typeid(Component))) return nullptr;
+            template <typename Component>
+            ObserverID OnSet(ComponentObserver observer)
+            {
+                return observers.Add(typeid(Component), ComponentEvent::Set, std::move(observer));
+            }
+
+            void RemoveObserver(ObserverID observer);
+            void NotifyObservers();
+
+            // Makes child the last child of parent, moving it from its current parent. Throws when either entity isn't
+            // registered or parent is child or one of its descendants. Deleting an entity turns its children into roots.
+            void SetParent(EntityID child, EntityID parent);
+            void RemoveParent(EntityID child);
+
+            // NoEntity for entities without a parent.
+            EntityID GetParent(EntityID entity) const;
+            Hierarchy::Children GetChildren(EntityID entity) const;
+
+            // Every entity in a hierarchy that has the components, by depth so parents come before their children.
+            // Within a depth, entities are in the order of their archetypes and rows, so a pass over a depth reads
+            // each column forward. Safe to call from systems running at the same time.
+            template <typename... QueryComponents>
+            HierarchyView<QueryComponents...> GetHierarchyView()
+            {
+                HierarchyView<QueryComponents...> view(viewResource);
+                std::tuple<SparseSet<QueryComponents>*...> sparseSets(GetQuerySparseSet<QueryComponents>()...);
+
+                std::lock_guard<std::mutex> lock(hierarchyMutex);
+                UpdateHierarchyLayout();
+
+                const HierarchyOrder& order = hierarchyLayout.order;
+
+                // Index of every entity of the order in the view, NoEntity for those left out.
+                std::pmr::vector<std::size_t> viewIndexes(order.entities.size(), NoEntity, viewResource);
+                view.Reserve(order.entities.size());
+
+                // Entities without table components have no archetype, they only match queries of sparse components.
+                std::tuple<QueryComponents*...> columns;
+                Archetype* lastArchetype = nullptr;
+                bool hasColumns = GetQueryColumns<QueryComponents...>(nullptr, columns);
+
+                for (std::size_t depth = 0; depth + 1 < order.levels.size(); depth++)
+                {
+                    for (std::size_t index = order.levels[depth]; index < order.levels[depth + 1]; index++)
+                    {
+                        const EntityRecord& record = hierarchyLayout.records[index];
+
+                        if (record.archetype != lastArchetype)
+                        {
+                            lastArchetype = record.archetype;
+                            hasColumns = GetQueryColumns<QueryComponents...>(record.archetype, columns);
+                        }
+
+                        if (!hasColumns) continue;
+
+                        EntityID entity = order.entities[index];
+                        bool complete = true;
+
+                        std::tuple<QueryComponents*...> components([&]<typename T>(T*) -> T* {
+                            if constexpr (SparseComponent<T>)
+                            {
+                                SparseSet<T>* sparseSet = std::get<SparseSet<T>*>(sparseSets);
+                                T* component = sparseSet ? sparseSet->Get(entity) : nullptr;
+
+                                complete = complete && component;
+                                return component;
+                            }
+                            else
+                            {
+                                return std::get<T*>(columns) + record.row;
+                            }
+                        }(static_cast<QueryComponents*>(nullptr))...);
+
+                        if (!complete) continue;
+
+                        std::size_t parent = order.parents[index] != NoEntity ? viewIndexes[order.parents[index]] : NoEntity;
+                        viewIndexes[index] = view.GetEntityCount();
+                        view.Add(entity, parent, components);
+                    }
+
+                    view.EndLevel();
+                }
 
-                return entityArchetype->GetComponent<Component>(entity);
+                return view;
+            }
+
+            template <typename Component>
+            Component* TryGetComponent(EntityID entity)
+            {
+                if constexpr (SparseComponent<Component>)
+                {
+                    SparseSet<Component>* sparseSet = TryGetSparseSet<Component>();
+                    return sparseSet ? sparseSet->Get(entity) : nullptr;
+                }
+
+                EntityRecord* record = TryGetRecord(entity);
+                if (!record) return nullptr;
+
+                return record->archetype->GetComponent<Component>(record->row);
             }
 
             template <typename Component>
@@ -241,24 +581,29 @@ namespace Weave
             template <typename... Components>
             void AddComponents(EntityID entity, Components... components)
             {
-                ((componentSizes[typeid(Components)] = sizeof(Components)), ...);
+                ([&] {
+                    if constexpr (SparseComponent<Components>)
+                    {
+                        SparseSet<Components>& sparseSet = GetSparseSet<Components>();
+                        if (observers.IsActive()) observers.Record(typeid(Components), entity, sparseSet.HasIndex(entity), true);
 
-                std::set<ComponentData> newTypeSet;
-                Archetype* oldArchetype = nullptr;
+                        sparseSet.Set(entity, components);
+                    }
+                    }(), ...);
+
+                std::apply([&](auto&&... tableComponents) {
+                    AddTableComponents(entity, std::move(tableComponents)...);
+                    }, std::tuple_cat(KeepTableComponent(components)...));
+            }
 
-                if (entityToArchetype.contains(entity))
+            template <typename... Components>
+            void AddTableComponents(EntityID entity, Components... components)
+            {
+                if constexpr (sizeof...(Components) > 0)
                 {
-                    oldArchetype = entityToArchetype[entity];
-                    newTypeSet = oldArchetype->GetComponentData();
+                    const ComponentOp ops[] = { ComponentOp{ &ComponentInfo::Of<Components>(), &components }... };
+                    ChangeTableComponents(entity, ops);
                 }
-
-                (newTypeSet.insert(ComponentData::GetComponentData<Components>()), ...);
-
-                Archetype* newArchetype = &GetArchetype(newTypeSet);
-
-                if (newArchetype == oldArchetype) return;
-
-                TransferEntity(entity, newArchetype, oldArchetype, std::forward<Components>(components)...);
             }
 
             template <typename Component>
@@ -270,57 +615,168 @@ namespace Weave
             template <typename... Components>
             void RemoveComponents(EntityID entity)
             {
-                if (!entityToArchetype.contains(entity)) return;
-
-                std::set<ComponentData> newTypeSet;
+                ([&] {
+                    if constexpr (SparseComponent<Components>)
+                    {
+                        if (SparseSet<Components>* sparseSet = TryGetSparseSet<Components>())
+                        {
+                            if (observers.IsActive()) observers.Record(typeid(Components), entity, sparseSet->HasIndex(entity), false);
+                            sparseSet->Delete(entity);
+                        }
+                    }
+                    }(), ...);
 
-                Archetype* oldArchetype = entityToArchetype[entity];
-                newTypeSet = oldArchetype->GetComponentData();
+                RemoveTableComponents(entity, static_cast<TableComponentTuple<Components...>*>(nullptr));
+            }
 
-                (oldArchetype->DestroyComponent(entity, typeid(Components)), ...);
-                (newTypeSet.erase({ typeid(Components), sizeof(Components) }), ...);
+            template <typename... Components>
+            void RemoveTableComponents(EntityID entity, std::tuple<Components...>*)
+            {
+                if constexpr (sizeof...(Components) > 0)
+                {
+                    const ComponentOp ops[] = { ComponentOp{ &ComponentInfo::Of<Components>(), nullptr }... };
+                    ChangeTableComponents(entity, ops);
+                }
+            }
 
-                Archetype* newArchetype = &GetArchetype(newTypeSet);
+            // Components by ID, see RuntimeComponents, for code that only knows its types at runtime. The value is
+            // copied, a null value default constructs the component.
+            void AddDynamicComponent(EntityID entity, ComponentID component, const void* value = nullptr);
+            void RemoveDynamicComponent(EntityID entity, ComponentID component);
+            void* TryGetDynamicComponent(EntityID entity, ComponentID component);
 
-                TransferEntity(entity, newArchetype, oldArchetype);
-            }
+            // Raw columns of the entities that have every component, one chunk per archetype, so scripts can iterate
+            // in bulk. Like any non-const access, counts as a change for rollback. Throws for sparse components.
+            DynamicView GetDynamicView(std::span<const ComponentID> components);
 
             template <typename... QueryComponents>
             WorldView<QueryComponents...> GetView()
             {
-                std::vector<ArchetypeView<QueryComponents...>> views;
+                std::pmr::vector<ArchetypeView<QueryComponents...>> views(viewResource);
+
+                constexpr bool hasTableComponents = (TableComponent<QueryComponents> || ...);
+                constexpr bool hasSparseComponents = (SparseComponent<QueryComponents> || ...);
 
-                std::set<Archetype*> matchingArchetypes;
+                std::tuple<SparseSet<QueryComponents>*...> sparseSets(GetQuerySparseSet<QueryComponents>()...);
 
-                if constexpr (sizeof...(QueryComponents) > 0)
+                if constexpr (hasSparseComponents)
                 {
-                    matchingArchetypes = componentToArchetypes[typeid(std::tuple_element_t<0, std::tuple<QueryComponents...>>)];
+                    bool missingSet = ([&]<typename T>(T*) {
+                        if constexpr (SparseComponent<T>) return std::get<SparseSet<T>*>(sparseSets) == nullptr;
+                        else return false;
+                    }(static_cast<QueryComponents*>(nullptr)) || ...);
+
+                    if (missingSet) return WorldView<QueryComponents...>(std::move(views));
                 }
 
+                if constexpr (!hasTableComponents)
+                {
+                    std::span<const EntityID> baseEntities;
+                    std::size_t minSize = std::numeric_limits<std::size_t>::max();
+
+                    ([&] {
+                        auto* set = std::get<SparseSet<QueryComponents>*>(sparseSets);
+                        if (set->Size() < minSize) {
+                            baseEntities = set->GetDenseIndexes();
+                            minSize = set->Size();
+                        }
+                        }(), ...);
+
+                    std::pmr::vector<EntityID> valid(viewResource);
+                    for (EntityID entity : baseEntities)
+                    {
+                        if (HasSparseComponents<QueryComponents...>(sparseSets, entity)) valid.push_back(entity);
+                    }
+
+                    if (!valid.empty())
+                    {
+                        views.emplace_back(valid.data(), nullptr, valid.size(), std::get<SparseSet<QueryComponents>*>(sparseSets)...);
+                    }
+
+                    return WorldView<QueryComponents...>(std::move(views), std::pmr::vector<std::size_t>(viewResource), std::move(valid));
+                }
+
+                std::pmr::set<Archetype*> matchingArchetypes(viewResource);
+                bool firstTableComponent = true;
+
                 ([&]<typename T>(T*) {
-                    const auto& archetypesForComponent = componentToArchetypes[typeid(T)];
-                    std::set<Archetype*> intersection;
-                    std::set_intersection(
-                        matchingArchetypes.begin(), matchingArchetypes.end(),
-                        archetypesForComponent.begin(), archetypesForComponent.end(),
-                        std::inserter(intersection, intersection.begin())
-                    );
-                    matchingArchetypes = std::move(intersection);
+                    if constexpr (TableComponent<T>)
+                    {
+                        // Systems running at the same time build views, so a missing component must not insert.
+                        auto it = componentToArchetypes.find(typeid(T));
+
+                        if (it == componentToArchetypes.end())
+                        {
+                            matchingArchetypes.clear();
+                            firstTableComponent = false;
+                            return;
+                        }
+
+                        const auto& archetypesForComponent = it->second;
+
+                        if (firstTableComponent)
+                        {
+                            matchingArchetypes.insert(archetypesForComponent.begin(), archetypesForComponent.end());
+                            firstTableComponent = false;
+                            return;
+                        }
+
+                        std::pmr::set<Archetype*> intersection(viewResource);
+                        std::set_intersection(
+                            matchingArchetypes.begin(), matchingArchetypes.end(),
+                            archetypesForComponent.begin(), archetypesForComponent.end(),
+                            std::inserter(intersection, intersection.begin())
+                        );
+                        matchingArchetypes = std::move(intersection);
+                    }
                 }(static_cast<QueryComponents*>(nullptr)), ...);
 
-                for (Archetype* archetype : matchingArchetypes)
+                if constexpr (!hasSparseComponents)
                 {
-                    std::vector<EntityID>& entityVector = archetype->GetEntityVector();
-                    if (entityVector.size() == 0) continue;
+                    for (Archetype* archetype : matchingArchetypes)
+                    {
+                        std::pmr::vector<EntityID>& entityVector = archetype->GetEntityVector();
+                        if (entityVector.size() == 0) continue;
 
-                    auto componentVectors = std::make_tuple(
-                        static_cast<std::vector<QueryComponents>*>(&archetype->GetComponentVector<QueryComponents>())...
-                    );
+                        views.emplace_back(entityVector.data(), nullptr, entityVector.size(),
+                            GetComponentSource<QueryComponents>(archetype, std::get<SparseSet<QueryComponents>*>(sparseSets))...);
+                    }
 
-                    views.emplace_back(ArchetypeView<QueryComponents...>(entityVector, *std::get<std::vector<QueryComponents>*>(componentVectors)...));
+                    return WorldView<QueryComponents...>(std::move(views));
                 }
+                else
+                {
+                    struct MatchingRange
+                    {
+                        Archetype* archetype;
+                        std::size_t offset;
+                        std::size_t count;
+                    };
 
-                return WorldView<QueryComponents...>(std::move(views));
+                    std::pmr::vector<MatchingRange> ranges(viewResource);
+                    std::pmr::vector<std::size_t> matchingRows(viewResource);
+
+                    for (Archetype* archetype : matchingArchetypes)
+                    {
+                        std::pmr::vector<EntityID>& entityVector = archetype->GetEntityVector();
+                        std::size_t offset = matchingRows.size();
+
+                        for (std::size_t row = 0; row < entityVector.size(); row++)
+                        {
+                            if (HasSparseComponents<QueryComponents...>(sparseSets, entityVector[row])) matchingRows.push_back(row);
+                        }
+
+                        if (matchingRows.size() > offset) ranges.push_back({ archetype, offset, matchingRows.size() - offset });
+                    }
+
+                    for (const MatchingRange& range : ranges)
+                    {
+                        views.emplace_back(range.archetype->GetEntityVector().data(), matchingRows.data() + range.offset, range.count,
+                            GetComponentSource<QueryComponents>(range.archetype, std::get<SparseSet<QueryComponents>*>(sparseSets))...);
+                    }
+
+                    return WorldView<QueryComponents...>(std::move(views), std::move(matchingRows));
+                }
             }
         };
     }
@@ -2,8 +2,20 @@
 #include <functional>
 #include <vector>
 #include <mutex>
+#include <memory>
+#include <atomic>
+#include <tuple>
+#include <new>
+#include <cstddef>
+#include <cstdint>
 #include <concepts>
+#include <algorithm>
+#include <stdexcept>
+#include <typeindex>
 #include "World.h"
+#include "ComponentInfo.h"
+#include "SystemAccess.h"
+#include "ThreadSlot.h"
 
 namespace Weave::ECS
 {
@@ -12,35 +24,508 @@ namespace Weave::ECS
         { fn(world, std::forward<Args>(args)...) } -> std::same_as<void>;
     };
 
-    class CommandBuffer 
+    enum class CommandType : std::uint8_t
     {
+        CreateEntity,
+        AddComponents,
+        RemoveComponents,
+        DeleteEntity,
+        Custom
+    };
+
+    // Defers structural changes until Flush. Every thread records into its own stream of typed commands
+    // placed in a linear arena, so recording takes no lock and, once the arenas have grown, no allocation.
+    class CommandBuffer
+    {
+    private:
+        struct Command
+        {
+            Command* next;
+            void (*apply)(World&, Command*);
+            void (*destroy)(Command*);
+
+            std::uint32_t phase;
+            std::uint64_t sortKey;
+            CommandType type;
+        };
+
+        template <typename... Components>
+        struct CreateEntityCommand : Command
+        {
+            std::tuple<Components...> components;
+
+            static void Apply(World& world, Command* command)
+            {
+                auto* self = static_cast<CreateEntityCommand*>(command);
+                EntityID entity = world.CreateEntity();
+
+                if constexpr (sizeof...(Components) > 0)
+                {
+                    std::apply([&](Components&... components) { world.AddComponents(entity, std::move(components)...); }, self->components);
+                }
+            }
+        };
+
+        // Adds, removals and deletions only record what changes, Flush coalesces them per entity before applying.
+        struct StructuralCommand : Command
+        {
+            EntityID entity;
+            ComponentOp* ops;
+            std::uint32_t opCount;
+
+            static void Destroy(Command* command)
+            {
+                auto* self = static_cast<StructuralCommand*>(command);
+
+                for (std::uint32_t index = 0; index < self->opCount; index++)
+                {
+                    if (self->ops[index].value) self->ops[index].info->destroy(self->ops[index].value);
+                }
+            }
+        };
+
+        template <typename Fn>
+        struct CustomCommand : Command
+        {
+            Fn fn;
+
+            static void Apply(World& world, Command* command)
+            {
+                static_cast<CustomCommand*>(command)->fn(world);
+            }
+        };
+
+        // Bump allocator over fixed blocks. Blocks are kept when the arena is reset, so a buffer that
+        // records a similar amount every frame stops allocating after the first few frames.
+        class CommandArena
+        {
+        private:
+            static constexpr std::size_t BlockSize = 16 * 1024;
+            static constexpr std::size_t BlockAlignment = 64;
+
+            struct Block
+            {
+                std::byte* data;
+                std::size_t size;
+            };
+
+            std::vector<Block> blocks;
+            std::size_t currentBlock = 0;
+            std::size_t offset = 0;
+
+        public:
+            CommandArena() = default;
+            CommandArena(const CommandArena&) = delete;
+            CommandArena& operator=(const CommandArena&) = delete;
+
+            ~CommandArena()
+            {
+                for (Block& block : blocks) ::operator delete(block.data, std::align_val_t(BlockAlignment));
+            }
+
+            void* Allocate(std::size_t size, std::size_t alignment)
+            {
+                if (alignment > BlockAlignment) throw std::invalid_argument("Command alignment exceeds the arena block alignment.");
+
+                while (currentBlock < blocks.size())
+                {
+                    std::size_t aligned = (offset + alignment - 1) & ~(alignment - 1);
+
+                    if (aligned + size <= blocks[currentBlock].size)
+                    {
+                        offset = aligned + size;
+                        return blocks[currentBlock].data + aligned;
+                    }
+
+                    currentBlock++;
+                    offset = 0;
+                }
+
+                std::size_t blockSize = std::max(BlockSize, size);
+                blocks.push_back({ static_cast<std::byte*>(::operator new(blockSize, std::align_val_t(BlockAlignment))), blockSize });
+                currentBlock = blocks.size() - 1;
+                offset = size;
+
+                return blocks[currentBlock].data;
+            }
+
+            void Reset()
+            {
+                currentBlock = 0;
+                offset = 0;
+            }
+        };
+
+        struct ThreadStream
+        {
+            CommandArena arena;
+            Command* head = nullptr;
+            Command* tail = nullptr;
+            std::size_t count = 0;
+
+            std::uint32_t phase = 0;
+            std::uint64_t sortKey = 0;
+
+            // Components the recorded commands change, so a sync point can tell whether it has to flush.
+            std::vector<std::type_index> touchedComponents;
+            bool touchesEverything = false;
+
+            void Touch(std::type_index type)
+            {
+                if (std::find(touchedComponents.begin(), touchedComponents.end(), type) == touchedComponents.end()) touchedComponents.push_back(type);
+            }
+        };
+
+        static constexpr std::size_t MaxThreads = 1024;
+
+        std::unique_ptr<std::atomic<ThreadStream*>[]> streams = std::make_unique<std::atomic<ThreadStream*>[]>(MaxThreads);
+        std::mutex streamCreationMutex;
+        std::vector<std::unique_ptr<ThreadStream>> ownedStreams;
+
+        std::vector<Command*> mergedCommands;
+
+        // Scratch buffers for coalescing, kept between flushes.
+        std::vector<StructuralCommand*> structuralRun;
+        std::vector<ComponentOp> coalescedOps;
+        std::vector<std::size_t> coalescedOffsets;
+        std::vector<EntityTransition> transitions;
+
+        ThreadStream& GetStream()
+        {
+            std::size_t slot = Utilities::ThreadSlot::Current();
+            if (slot >= MaxThreads) throw std::runtime_error("Too many threads recording into a CommandBuffer.");
+
+            ThreadStream* stream = streams[slot].load(std::memory_order_acquire);
+            if (stream) return *stream;
+
+            std::lock_guard<std::mutex> lock(streamCreationMutex);
+            ownedStreams.push_back(std::make_unique<ThreadStream>());
+            stream = ownedStreams.back().get();
+            streams[slot].store(stream, std::memory_order_release);
+
+            return *stream;
+        }
+
+        template <typename T, typename... Args>
+        T& Record(CommandType type, Args&&... args)
+        {
+            return Record<T>(GetStream(), type, std::forward<Args>(args)...);
+        }
+
+        template <typename T, typename... Args>
+        T& Record(ThreadStream& stream, CommandType type, Args&&... args)
+        {
+            static_assert(std::is_base_of_v<Command, T>);
+
+            void (*apply)(World&, Command*) = nullptr;
+            if constexpr (requires { T::Apply; }) apply = &T::Apply;
+
+            T* command = new (stream.arena.Allocate(sizeof(T), alignof(T))) T{ Command{ nullptr, apply, nullptr, stream.phase, stream.sortKey, type }, std::forward<Args>(args)... };
+
+            if constexpr (!std::is_trivially_destructible_v<T>)
+            {
+                command->destroy = [](Command* command) { static_cast<T*>(command)->~T(); };
+            }
+
+            if (stream.tail) stream.tail->next = command;
+            else stream.head = command;
+
+            stream.tail = command;
+            stream.count++;
+
+            return *command;
+        }
+
+        template <typename... Components>
+        ComponentOp* AllocateOps(ThreadStream& stream)
+        {
+            if constexpr (sizeof...(Components) == 0) return nullptr;
+            else return static_cast<ComponentOp*>(stream.arena.Allocate(sizeof(ComponentOp) * sizeof...(Components), alignof(ComponentOp)));
+        }
+
+        static bool IsStructural(const Command* command)
+        {
+            return command->type == CommandType::AddComponents || command->type == CommandType::RemoveComponents || command->type == CommandType::DeleteEntity;
+        }
+
+        static void DestroyCommand(Command* command)
+        {
+            if (command->destroy) command->destroy(command);
+        }
+
     public:
+        CommandBuffer() = default;
+        CommandBuffer(const CommandBuffer&) = delete;
+        CommandBuffer& operator=(const CommandBuffer&) = delete;
+
+        ~CommandBuffer()
+        {
+            for (std::unique_ptr<ThreadStream>& stream : ownedStreams)
+            {
+                for (Command* command = stream->head; command; command = command->next) DestroyCommand(command);
+            }
+        }
+
         template<typename Fn, typename... Args>
         requires CommandFunction<Fn, Args...>
-        void AddCommand(Fn&& fn, Args&&... args) 
+        void AddCommand(Fn&& fn, Args&&... args)
         {
-            std::lock_guard<std::mutex> lock(mutex_);
-            commands_.emplace_back(
-                [fn = std::forward<Fn>(fn), ...args = std::forward<Args>(args)](World& world) mutable
+            auto command = [fn = std::forward<Fn>(fn), ...args = std::forward<Args>(args)](World& world) mutable
                 {
                     fn(world, std::forward<Args>(args)...);
+                };
+
+            ThreadStream& stream = GetStream();
+            stream.touchesEverything = true;
+
+            Record<CustomCommand<decltype(command)>>(stream, CommandType::Custom, std::move(command));
+        }
+
+        template <typename... Components>
+        void CreateEntity(Components... components)
+        {
+            ThreadStream& stream = GetStream();
+            (stream.Touch(typeid(Components)), ...);
+
+            Record<CreateEntityCommand<Components...>>(stream, CommandType::CreateEntity, std::tuple<Components...>(std::move(components)...));
+        }
+
+        template <typename... Components>
+        void AddComponents(EntityID entity, Components... components)
+        {
+            ThreadStream& stream = GetStream();
+            ComponentOp* ops = AllocateOps<Components...>(stream);
+            std::size_t index = 0;
+
+            ((ops[index++] = ComponentOp{ &ComponentInfo::Of<Components>(), new (stream.arena.Allocate(sizeof(Components), alignof(Components))) Components(std::move(components)) }), ...);
+            (stream.Touch(typeid(Components)), ...);
+
+            StructuralCommand& command = Record<StructuralCommand>(stream, CommandType::AddComponents, entity, ops, static_cast<std::uint32_t>(sizeof...(Components)));
+            if constexpr (!(std::is_trivially_destructible_v<Components> && ...)) command.destroy = &StructuralCommand::Destroy;
+        }
+
+        template <typename Component>
+        void AddComponent(EntityID entity, Component component = Component())
+        {
+            AddComponents(entity, std::move(component));
+        }
+
+        template <typename... Components>
+        void RemoveComponents(EntityID entity)
+        {
+            ThreadStream& stream = GetStream();
+            ComponentOp* ops = AllocateOps<Components...>(stream);
+            std::size_t index = 0;
+
+            ((ops[index++] = ComponentOp{ &ComponentInfo::Of<Components>(), nullptr }), ...);
+            (stream.Touch(typeid(Components)), ...);
+
+            Record<StructuralCommand>(stream, CommandType::RemoveComponents, entity, ops, static_cast<std::uint32_t>(sizeof...(Components)));
+        }
+
+        template <typename Component>
+        void RemoveComponent(EntityID entity)
+        {
+            RemoveComponents<Component>(entity);
+        }
+
+        void DeleteEntity(EntityID entity)
+        {
+            ThreadStream& stream = GetStream();
+            stream.touchesEverything = true;
+
+            Record<StructuralCommand>(stream, CommandType::DeleteEntity, entity, static_cast<ComponentOp*>(nullptr), std::uint32_t(0));
+        }
+
+        // Must not run while other threads are recording.
+        bool IsEmpty()
+        {
+            std::lock_guard<std::mutex> lock(streamCreationMutex);
+            return std::none_of(ownedStreams.begin(), ownedStreams.end(), [](const std::unique_ptr<ThreadStream>& stream) { return stream->head; });
+        }
+
+        // True when applying the recorded commands may change what a system with this access sees.
+        // Must not run while other threads are recording.
+        bool Affects(const SystemAccess& access)
+        {
+            std::lock_guard<std::mutex> lock(streamCreationMutex);
+
+            for (const std::unique_ptr<ThreadStream>& stream : ownedStreams)
+            {
+                if (!stream->head) continue;
+                if (access.exclusive || stream->touchesEverything) return true;
+
+                for (const std::type_index& type : stream->touchedComponents)
+                {
+                    if (access.Touches(type)) return true;
                 }
-            );
+            }
+
+            return false;
+        }
+
+        // Commands are applied ordered by phase, then by sort key, then in the order each thread recorded them.
+        // Streams from different threads merge deterministically as long as each (phase, key) pair is only
+        // recorded from one thread, the Engine uses the system's position in its group and the entity being processed.
+        void BeginPhase(std::uint32_t phase)
+        {
+            ThreadStream& stream = GetStream();
+            stream.phase = phase;
+            stream.sortKey = 0;
+        }
+
+        std::uint32_t GetPhase()
+        {
+            return GetStream().phase;
+        }
+
+        void SetSortKey(std::uint32_t phase, std::uint64_t sortKey)
+        {
+            ThreadStream& stream = GetStream();
+            stream.phase = phase;
+            stream.sortKey = sortKey;
         }
 
+        // Must not run while other threads are recording. Entities reserved with World::ReserveEntity become
+        // alive before any command is applied, component observers are notified once every command is.
         void Flush(World& world) {
-            std::vector<std::function<void(World&)>> commands;
+            world.FlushReservedEntities();
+            mergedCommands.clear();
+
             {
-                std::lock_guard<std::mutex> lock(mutex_);
-                commands.swap(commands_);
+                std::lock_guard<std::mutex> lock(streamCreationMutex);
+
+                for (std::unique_ptr<ThreadStream>& stream : ownedStreams)
+                {
+                    for (Command* command = stream->head; command; command = command->next) mergedCommands.push_back(command);
+
+                    stream->head = nullptr;
+                    stream->tail = nullptr;
+                    stream->count = 0;
+                    stream->touchedComponents.clear();
+                    stream->touchesEverything = false;
+                }
+            }
+
+            if (mergedCommands.empty())
+            {
+                world.NotifyObservers();
+                return;
+            }
+
+            std::stable_sort(mergedCommands.begin(), mergedCommands.end(), [](const Command* a, const Command* b)
+                {
+                    if (a->phase != b->phase) return a->phase < b->phase;
+                    return a->sortKey < b->sortKey;
+                });
+
+            try
+            {
+                for (std::size_t index = 0; index < mergedCommands.size();)
+                {
+                    if (!IsStructural(mergedCommands[index]))
+                    {
+                        mergedCommands[index]->apply(world, mergedCommands[index]);
+                        index++;
+                        continue;
+                    }
+
+                    std::size_t end = index + 1;
+                    while (end < mergedCommands.size() && IsStructural(mergedCommands[end])) end++;
+
+                    ApplyStructuralRun(world, index, end);
+                    index = end;
+                }
             }
-            for (auto& cmd : commands) {
-                cmd(world);
+            catch (...)
+            {
+                DestroyMergedCommands();
+                throw;
             }
+
+            DestroyMergedCommands();
+            world.NotifyObservers();
         }
 
     private:
-        std::mutex mutex_;
-        std::vector<std::function<void(World&)>> commands_;
+        // Reduces a run of adds, removals and deletions to one transition per entity: the last add or removal
+        // of a component wins, a deletion discards what came before it and drops what was recorded after it, so a
+        // deleted entity ends up with no ops. World::ApplyTransitions then moves all
+        // entities that go between the same pair of archetypes at once.
+        // Custom commands and entity creation may observe the world, so runs never cross them.
+        void ApplyStructuralRun(World& world, std::size_t begin, std::size_t end)
+        {
+            structuralRun.clear();
+            for (std::size_t index = begin; index < end; index++) structuralRun.push_back(static_cast<StructuralCommand*>(mergedCommands[index]));
+
+            auto byEntity = [](const StructuralCommand* a, const StructuralCommand* b) { return a->entity < b->entity; };
+            if (!std::is_sorted(structuralRun.begin(), structuralRun.end(), byEntity)) std::stable_sort(structuralRun.begin(), structuralRun.end(), byEntity);
+
+            coalescedOps.clear();
+            coalescedOffsets.clear();
+            transitions.clear();
+
+            // Spans are filled in once coalescedOps stops growing, until then they only carry the op count.
+            for (std::size_t index = 0; index < structuralRun.size();)
+            {
+                EntityID entity = structuralRun[index]->entity;
+                std::size_t offset = coalescedOps.size();
+                bool deleted = false;
+
+                for (; index < structuralRun.size() && structuralRun[index]->entity == entity; index++)
+                {
+                    StructuralCommand* command = structuralRun[index];
+
+                    // The ID may be reused once the entity is deleted, so later commands must not touch it.
+                    if (deleted) continue;
+
+                    if (command->type == CommandType::DeleteEntity)
+                    {
+                        deleted = true;
+                        coalescedOps.resize(offset);
+                        continue;
+                    }
+
+                    for (std::uint32_t op = 0; op < command->opCount; op++)
+                    {
+                        auto existing = std::find_if(coalescedOps.begin() + offset, coalescedOps.end(), [&](const ComponentOp& other) { return other.info == command->ops[op].info; });
+
+                        if (existing != coalescedOps.end()) *existing = command->ops[op];
+                        else coalescedOps.push_back(command->ops[op]);
+                    }
+                }
+
+                if (!deleted && coalescedOps.size() == offset) continue;
+
+                coalescedOffsets.push_back(offset);
+                transitions.push_back({ entity, deleted, std::span<const ComponentOp>(static_cast<const ComponentOp*>(nullptr), coalescedOps.size() - offset) });
+            }
+
+            for (std::size_t index = 0; index < transitions.size(); index++)
+            {
+                transitions[index].ops = std::span<const ComponentOp>(coalescedOps.data() + coalescedOffsets[index], transitions[index].ops.size());
+            }
+
+            world.ApplyTransitions(transitions);
+        }
+
+        void DestroyMergedCommands()
+        {
+            for (Command* command : mergedCommands) DestroyCommand(command);
+            mergedCommands.clear();
+
+            ResetArenas();
+        }
+
+        void ResetArenas()
+        {
+            std::lock_guard<std::mutex> lock(streamCreationMutex);
+
+            // Commands recorded while flushing (from custom commands) still live in their arena until the next flush.
+            for (std::unique_ptr<ThreadStream>& stream : ownedStreams)
+            {
+                if (!stream->head) stream->arena.Reset();
+            }
+        }
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <typeindex>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <new>
+#include <type_traits>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include "ComponentTraits.h"
+#include "SparseSet/SparseSet.h"
+
+namespace Weave
+{
+	namespace ECS
+	{
+		using EntityID = std::size_t;
+
+		// Type erased description of a component type, one static instance per type.
+		struct ComponentInfo
+		{
+			std::type_index type;
+			std::size_t size;
+			std::size_t alignment;
+			bool triviallyCopyable;
+			StorageType storage;
+
+			void (*moveConstruct)(void* destination, void* source);
+			void (*copyConstruct)(void* destination, const void* source); // Throws for types that can't be copied.
+			void (*defaultConstruct)(void* destination); // Throws for types that can't be default constructed.
+			void (*destroy)(void* component);
+			std::unique_ptr<ISparseSet>(*createSparseSet)(std::pmr::memory_resource* resource);
+
+			// Moves a component into uninitialized memory and ends the lifetime of the source.
+			void Relocate(void* destination, void* source) const
+			{
+				if (triviallyCopyable)
+				{
+					std::memcpy(destination, source, size);
+					return;
+				}
+
+				moveConstruct(destination, source);
+				destroy(source);
+			}
+
+			template <typename T>
+			static const ComponentInfo& Of()
+			{
+				static const ComponentInfo info{
+					typeid(T),
+					sizeof(T),
+					alignof(T),
+					std::is_trivially_copyable_v<T>,
+					ComponentStorage<T>::value,
+					[](void* destination, void* source) { new (destination) T(std::move(*static_cast<T*>(source))); },
+					[](void* destination, const void* source) {
+						if constexpr (std::is_copy_constructible_v<T>) new (destination) T(*static_cast<const T*>(source));
+						else throw std::logic_error("Component type is not copy constructible.");
+					},
+					[](void* destination) {
+						if constexpr (std::is_default_constructible_v<T>) new (destination) T();
+						else throw std::logic_error("Component type is not default constructible.");
+					},
+					[](void* component) { static_cast<T*>(component)->~T(); },
+					[](std::pmr::memory_resource* resource) -> std::unique_ptr<ISparseSet> { return std::make_unique<SparseSet<T>>(resource); }
+				};
+
+				return info;
+			}
+		};
+
+		// A component constructed outside the world, as a copy of value or default constructed when value is null,
+		// for ops that move it into the world. Destroyed with its memory.
+		class ComponentValue
+		{
+		private:
+			const ComponentInfo& info;
+			std::pmr::memory_resource* resource;
+			void* data;
+
+		public:
+			ComponentValue(const ComponentInfo& info, std::pmr::memory_resource* resource, const void* value)
+				: info(info), resource(resource), data(resource->allocate(info.size, info.alignment))
+			{
+				try
+				{
+					if (value) info.copyConstruct(data, value);
+					else info.defaultConstruct(data);
+				}
+				catch (...)
+				{
+					resource->deallocate(data, info.size, info.alignment);
+					throw;
+				}
+			}
+
+			ComponentValue(const ComponentValue&) = delete;
+			ComponentValue& operator=(const ComponentValue&) = delete;
+
+			~ComponentValue()
+			{
+				info.destroy(data);
+				resource->deallocate(data, info.size, info.alignment);
+			}
+
+			void* Get() const
+			{
+				return data;
+			}
+		};
+
+		// One component of a structural change. A value adds (or overwrites) the component by moving from it,
+		// a null value removes the component.
+		struct ComponentOp
+		{
+			const ComponentInfo* info;
+			void* value;
+		};
+
+		// The net structural change to one entity, applied by World::ApplyTransitions.
+		// A deleted transition has no ops.
+		struct EntityTransition
+		{
+			EntityID entity;
+			bool deleted;
+			std::span<const ComponentOp> ops;
+		};
+	}
+}
@@ -0,0 +1,112 @@
+#include "ComponentObservers.h"
+#include <algorithm>
+#include <stdexcept>
+
+Weave::ECS::ObserverID Weave::ECS::ComponentObservers::Add(std::type_index type, ComponentEvent event, ComponentObserver fn)
+{
+	if (notifying) throw std::logic_error("Observers can't be added while they are notified.");
+
+	ObservedType*& observed = typeLookup[type];
+
+	if (!observed)
+	{
+		types.push_back(std::make_unique<ObservedType>());
+		observed = types.back().get();
+	}
+
+	observed->observers.push_back({ nextObserverID, event, std::move(fn) });
+	observerCount++;
+
+	return nextObserverID++;
+}
+
+bool Weave::ECS::ComponentObservers::Remove(ObserverID id)
+{
+	if (notifying) throw std::logic_error("Observers can't be removed while they are notified.");
+
+	for (std::unique_ptr<ObservedType>& observed : types)
+	{
+		auto it = std::find_if(observed->observers.begin(), observed->observers.end(), [id](const Observer& observer) { return observer.id == id; });
+		if (it == observed->observers.end()) continue;
+
+		observed->observers.erase(it);
+		observerCount--;
+
+		if (observed->observers.empty()) observed->events.clear();
+		return true;
+	}
+
+	return false;
+}
+
+void Weave::ECS::ComponentObservers::Notify(World& world)
+{
+	if (notifying) return;
+
+	struct NotifyingScope
+	{
+		bool& notifying;
+		NotifyingScope(bool& notifying) : notifying(notifying) { notifying = true; }
+		~NotifyingScope() { notifying = false; }
+	} scope(notifying);
+
+	// Events are taken out of every type first, those recorded by the observers themselves wait for the next Notify.
+	for (std::unique_ptr<ObservedType>& observed : types)
+	{
+		observed->delivering.clear();
+		observed->delivering.swap(observed->events);
+	}
+
+	for (std::unique_ptr<ObservedType>& observed : types)
+	{
+		std::vector<RecordedEvent>& events = observed->delivering;
+		if (events.empty()) continue;
+
+		auto byEntity = [](const RecordedEvent& a, const RecordedEvent& b) { return a.entity < b.entity; };
+		if (!std::is_sorted(events.begin(), events.end(), byEntity)) std::stable_sort(events.begin(), events.end(), byEntity);
+
+		for (std::vector<EntityID>& batch : batches) batch.clear();
+
+		for (std::size_t begin = 0; begin < events.size();)
+		{
+			std::size_t end = begin + 1;
+			while (end < events.size() && events[end].entity == events[begin].entity) end++;
+
+			// The first event tells whether the entity had the component before, the last whether it has it now.
+			bool had = events[begin].event != ComponentEvent::Add;
+			bool has = events[end - 1].event != ComponentEvent::Remove;
+			bool removed = false;
+			bool set = false;
+
+			for (std::size_t index = begin; index < end; index++)
+			{
+				removed = removed || events[index].event == ComponentEvent::Remove;
+				set = set || events[index].event == ComponentEvent::Set;
+			}
+
+			EntityID entity = events[begin].entity;
+
+			if (had && (!has || removed)) batches[static_cast<std::size_t>(ComponentEvent::Remove)].push_back(entity);
+			if (has && (!had || removed)) batches[static_cast<std::size_t>(ComponentEvent::Add)].push_back(entity);
+			if (had && has && !removed && set) batches[static_cast<std::size_t>(ComponentEvent::Set)].push_back(entity);
+
+			begin = end;
+		}
+
+		for (ComponentEvent event : { ComponentEvent::Remove, ComponentEvent::Add, ComponentEvent::Set })
+		{
+			const std::vector<EntityID>& batch = batches[static_cast<std::size_t>(event)];
+			if (batch.empty()) continue;
+
+			for (Observer& observer : observed->observers)
+			{
+				if (observer.event == event) observer.fn(world, batch);
+			}
+		}
+	}
+}
+
+void Weave::ECS::ComponentObservers::Discard()
+{
+	for (std::unique_ptr<ObservedType>& observed : types) observed->events.clear();
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <functional>
+#include <unordered_map>
+#include <typeindex>
+#include <vector>
+#include <memory>
+#include <span>
+#include <cstdint>
+#include <cstddef>
+
+namespace Weave
+{
+	namespace ECS
+	{
+		using EntityID = std::size_t;
+		using ObserverID = std::size_t;
+
+		class World;
+
+		enum class ComponentEvent : std::uint8_t
+		{
+			Add,    // The entity gained the component.
+			Remove, // The entity lost the component, or was deleted.
+			Set     // The entity kept the component and a new value was written over it.
+		};
+
+		// Receives the entities of one event for one component type, sorted and without duplicates.
+		using ComponentObserver = std::function<void(World&, std::span<const EntityID>)>;
+
+		// Collects component lifecycle events into one batch per observed type, delivered by Notify. Each entity is
+		// reported with its net change since the last Notify: a component added and removed again is not reported,
+		// one removed and added again is reported as both. Nothing is recorded for types no observer watches.
+		class ComponentObservers
+		{
+		private:
+			struct Observer
+			{
+				ObserverID id;
+				ComponentEvent event;
+				ComponentObserver fn;
+			};
+
+			struct RecordedEvent
+			{
+				EntityID entity;
+				ComponentEvent event;
+			};
+
+			struct ObservedType
+			{
+				std::vector<Observer> observers;
+				std::vector<RecordedEvent> events;
+				std::vector<RecordedEvent> delivering; // Events taken by the running Notify.
+			};
+
+			// Types in the order they were first observed, so notifications run in a stable order.
+			std::vector<std::unique_ptr<ObservedType>> types;
+			std::unordered_map<std::type_index, ObservedType*> typeLookup;
+
+			std::size_t observerCount = 0;
+			ObserverID nextObserverID = 0;
+			bool notifying = false;
+
+			// Scratch of Notify, kept between calls.
+			std::vector<EntityID> batches[3];
+
+		public:
+			ObserverID Add(std::type_index type, ComponentEvent event, ComponentObserver fn);
+
+			// Returns false when the observer was already removed.
+			bool Remove(ObserverID id);
+
+			bool IsActive() const
+			{
+				return observerCount > 0;
+			}
+
+			// Records that an entity had the component before a change and has it after. Callers check IsActive
+			// first, so structural changes pay nothing while no observer is registered.
+			void Record(std::type_index type, EntityID entity, bool had, bool has)
+			{
+				if (!had && !has) return;
+
+				std::unordered_map<std::type_index, ObservedType*>::iterator it = typeLookup.find(type);
+				if (it == typeLookup.end() || it->second->observers.empty()) return;
+
+				it->second->events.push_back({ entity, had ? (has ? ComponentEvent::Set : ComponentEvent::Remove) : ComponentEvent::Add });
+			}
+
+			// Delivers every batch: per type, removals first, then additions, then sets. Changes the observers make
+			// to the world are delivered by the next Notify. Observers can't be added or removed while notified.
+			void Notify(World& world);
+
+			// Drops the recorded events, for changes that replace the whole world such as restoring a snapshot.
+			void Discard();
+		};
+	}
+}
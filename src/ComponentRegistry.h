@@ -0,0 +1,125 @@
+#pragma once
+#include <unordered_map>
+#include <typeindex>
+#include <string>
+#include <string_view>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <cstdint>
+#include "ComponentInfo.h"
+
+namespace Weave
+{
+	namespace ECS
+	{
+		struct RegisteredComponent
+		{
+			std::uint64_t stableID;   // Hash of the name, the same in every build and on every platform.
+			std::uint64_t layoutHash; // Hash of the name, size, alignment and version. Bump the version when the fields change.
+			std::string name;
+			const ComponentInfo* info;
+		};
+
+		// Gives component types an ID that outlives the process, so saved worlds can be matched to types when
+		// they are loaded. Register every saved type before loading, WEAVE_REGISTER_COMPONENT does it at startup.
+		class ComponentRegistry
+		{
+		private:
+			std::mutex mutex;
+			std::unordered_map<std::type_index, RegisteredComponent> byType;
+			std::unordered_map<std::uint64_t, const RegisteredComponent*> byStableID;
+
+		public:
+			static ComponentRegistry& Get()
+			{
+				static ComponentRegistry registry;
+				return registry;
+			}
+
+			// 64 bit FNV-1a.
+			static constexpr std::uint64_t Hash(std::string_view text, std::uint64_t hash = 14695981039346656037ull)
+			{
+				for (char c : text)
+				{
+					hash ^= static_cast<unsigned char>(c);
+					hash *= 1099511628211ull;
+				}
+
+				return hash;
+			}
+
+			static constexpr std::uint64_t Hash(std::uint64_t value, std::uint64_t hash)
+			{
+				for (int byte = 0; byte < 8; byte++)
+				{
+					hash ^= (value >> (byte * 8)) & 0xff;
+					hash *= 1099511628211ull;
+				}
+
+				return hash;
+			}
+
+			template <typename T>
+			const RegisteredComponent& Register(std::string_view name, std::uint32_t version = 0)
+			{
+				static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable components can be saved in snapshots.");
+
+				return Register(ComponentInfo::Of<T>(), name, version);
+			}
+
+			// Registers a type by its description, for types defined at runtime, see RuntimeComponents.
+			const RegisteredComponent& Register(const ComponentInfo& info, std::string_view name, std::uint32_t version = 0)
+			{
+				if (!info.triviallyCopyable) throw std::logic_error("Only trivially copyable components can be saved in snapshots.");
+
+				std::uint64_t stableID = Hash(name);
+				std::uint64_t layoutHash = Hash(version, Hash(info.alignment, Hash(info.size, stableID)));
+
+				std::lock_guard<std::mutex> lock(mutex);
+
+				auto typeIt = byType.find(info.type);
+				if (typeIt != byType.end())
+				{
+					if (typeIt->second.stableID != stableID || typeIt->second.layoutHash != layoutHash)
+						throw std::logic_error("Component type is already registered under another name or version.");
+
+					return typeIt->second;
+				}
+
+				if (byStableID.contains(stableID))
+					throw std::logic_error("Another component type is already registered as " + std::string(name) + ".");
+
+				RegisteredComponent& entry = byType.emplace(info.type, RegisteredComponent{ stableID, layoutHash, std::string(name), &info }).first->second;
+				byStableID[stableID] = &entry;
+
+				return entry;
+			}
+
+			const RegisteredComponent* Find(std::type_index type)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+
+				auto it = byType.find(type);
+				return it != byType.end() ? &it->second : nullptr;
+			}
+
+			const RegisteredComponent* Find(std::uint64_t stableID)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+
+				auto it = byStableID.find(stableID);
+				return it != byStableID.end() ? it->second : nullptr;
+			}
+		};
+	}
+}
+
+#define WEAVE_REGISTRY_CONCAT_INNER(a, b) a##b
+#define WEAVE_REGISTRY_CONCAT(a, b) WEAVE_REGISTRY_CONCAT_INNER(a, b)
+
+// Registers a component for snapshots under its spelled name, e.g. WEAVE_REGISTER_COMPONENT(Game::Position) or
+// WEAVE_REGISTER_COMPONENT(Game::Position, 2) after changing its fields. Use at namespace scope.
+#define WEAVE_REGISTER_COMPONENT(Type, ...) \
+	static const ::Weave::ECS::RegisteredComponent& WEAVE_REGISTRY_CONCAT(weaveRegisteredComponent, __COUNTER__) = \
+		::Weave::ECS::ComponentRegistry::Get().Register<Type>(#Type __VA_OPT__(,) __VA_ARGS__)
@@ -0,0 +1,37 @@
+#pragma once
+#include <type_traits>
+
+namespace Weave
+{
+	namespace ECS
+	{
+		enum class StorageType
+		{
+			Table,
+			Sparse
+		};
+
+		// Storage policy for a component type. Table components live in archetype columns and are
+		// fastest to iterate, sparse components live in their own sparse set so adding or removing
+		// them never moves the entity between archetypes. Specialize (or use WEAVE_SPARSE_COMPONENT)
+		// to change the policy of a type. The SparseSet backend stores every component sparsely.
+		template <typename Component>
+		struct ComponentStorage
+		{
+			static constexpr StorageType value = StorageType::Table;
+		};
+
+		template <typename Component>
+		concept SparseComponent = ComponentStorage<std::remove_cv_t<Component>>::value == StorageType::Sparse;
+
+		template <typename Component>
+		concept TableComponent = !SparseComponent<Component>;
+	}
+}
+
+#define WEAVE_SPARSE_COMPONENT(Type) \
+	template <> \
+	struct Weave::ECS::ComponentStorage<Type> \
+	{ \
+		static constexpr Weave::ECS::StorageType value = Weave::ECS::StorageType::Sparse; \
+	}
@@ -0,0 +1,373 @@
+#include "Delta.h"
+#include "Snapshot.h"
+#include <unordered_map>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <bit>
+
+namespace
+{
+	constexpr char Magic[8] = { 'W', 'E', 'A', 'V', 'E', 'D', 'L', 'T' };
+	constexpr std::uint32_t Version = 1;
+	constexpr std::uint32_t ByteOrderMark = 0x01020304;
+
+	struct DeltaHeader
+	{
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t byteOrder;
+		std::uint64_t baseline;
+		std::uint64_t target;
+	};
+
+	void WriteBytes(std::vector<std::byte>& out, const void* bytes, std::size_t count)
+	{
+		// Resized and copied into rather than inserted, GCC's -Wstringop-overflow misreads the growth of an empty vector.
+		std::size_t offset = out.size();
+		out.resize(offset + count);
+		std::memcpy(out.data() + offset, bytes, count);
+	}
+
+	// LEB128, 7 bits per byte.
+	void WriteVarint(std::vector<std::byte>& out, std::uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			out.push_back(static_cast<std::byte>(value | 0x80));
+			value >>= 7;
+		}
+
+		out.push_back(static_cast<std::byte>(value));
+	}
+
+	// Sorted IDs as the count followed by the difference to the previous ID.
+	void WriteEntities(std::vector<std::byte>& out, std::span<const Weave::ECS::EntityID> entities)
+	{
+		WriteVarint(out, entities.size());
+
+		Weave::ECS::EntityID previous = 0;
+
+		for (Weave::ECS::EntityID entity : entities)
+		{
+			WriteVarint(out, entity - previous);
+			previous = entity;
+		}
+	}
+
+	class DeltaReader
+	{
+	private:
+		std::span<const std::byte> data;
+		std::size_t offset = 0;
+
+	public:
+		explicit DeltaReader(std::span<const std::byte> data)
+			: data(data) {}
+
+		[[noreturn]] static void Corrupt()
+		{
+			throw std::runtime_error("Delta is truncated or corrupt.");
+		}
+
+		const std::byte* Read(std::size_t count)
+		{
+			if (count > data.size() - offset) Corrupt();
+
+			const std::byte* bytes = data.data() + offset;
+			offset += count;
+
+			return bytes;
+		}
+
+		std::uint64_t ReadVarint()
+		{
+			std::uint64_t value = 0;
+
+			for (int shift = 0; shift < 64; shift += 7)
+			{
+				std::uint64_t byte = static_cast<std::uint64_t>(*Read(1));
+				value |= (byte & 0x7f) << shift;
+
+				if (!(byte & 0x80)) return value;
+			}
+
+			Corrupt();
+		}
+
+		// Every entity takes at least a byte, which bounds the count before anything is allocated.
+		std::size_t ReadCount()
+		{
+			std::uint64_t count = ReadVarint();
+			if (count > data.size() - offset) Corrupt();
+
+			return static_cast<std::size_t>(count);
+		}
+
+		void ReadEntities(std::vector<Weave::ECS::EntityID>& entities)
+		{
+			entities.resize(ReadCount());
+
+			for (std::size_t index = 0; index < entities.size(); index++)
+			{
+				std::uint64_t difference = ReadVarint();
+				entities[index] = index > 0 ? entities[index - 1] + difference : difference;
+
+				// Strictly increasing, so no entity is listed twice.
+				if (index > 0 && (difference == 0 || entities[index] < entities[index - 1])) Corrupt();
+			}
+		}
+
+		bool AtEnd() const
+		{
+			return offset == data.size();
+		}
+	};
+}
+
+Weave::ECS::DeltaWriter::TypeChanges& Weave::ECS::DeltaWriter::GetType(std::type_index type)
+{
+	if (lastType && lastType->component->info->type == type) return *lastType;
+
+	auto it = std::find_if(types.begin(), types.end(), [type](const TypeChanges& changes) { return changes.component->info->type == type; });
+
+	if (it == types.end())
+	{
+		TypeChanges& changes = types.emplace_back();
+		changes.component = &GetSnapshotComponent(type);
+		it = types.end() - 1;
+	}
+
+	lastType = &*it;
+	return *lastType;
+}
+
+void Weave::ECS::DeltaWriter::AddEntityChanges(const EntityAllocator::State* from, const EntityAllocator::State& to)
+{
+	if (from == &to) return;
+
+	std::size_t words = std::max(from ? from->alive.size() : 0, to.alive.size());
+
+	// Words that are the same in both are skipped whole.
+	for (std::size_t word = 0; word < words; word++)
+	{
+		std::uint64_t was = from && word < from->alive.size() ? from->alive[word] : 0;
+		std::uint64_t is = word < to.alive.size() ? to.alive[word] : 0;
+
+		for (std::uint64_t changed = was ^ is; changed != 0; changed &= changed - 1)
+		{
+			int bit = std::countr_zero(changed);
+			EntityID entity = word * 64 + bit;
+
+			if (is >> bit & 1) spawned.push_back(entity);
+			else destroyed.push_back(entity);
+		}
+	}
+}
+
+void Weave::ECS::DeltaWriter::AddSparseSetChanges(const SparseSetCopy* from, const SparseSetCopy& to, const EntityAllocator::State& alive)
+{
+	if (from == &to) return;
+
+	const ComponentInfo& info = *GetType(to.GetType()).component->info;
+	const std::vector<std::size_t>& entities = *to.denseToSparse;
+	const std::byte* values = static_cast<const std::byte*>(to.GetDenseData());
+
+	auto changed = [&](const SparseSetCopy& before, std::size_t beforeIndex, std::size_t index)
+		{
+			return std::memcmp(static_cast<const std::byte*>(before.GetDenseData()) + beforeIndex * info.size, values + index * info.size, info.size) != 0;
+		};
+
+	// Rows that hold the same entity in both copies only need their bytes compared, adds and removes move few
+	// of them. The others are matched up by entity.
+	const std::vector<std::size_t>* baselineEntities = from ? from->denseToSparse.get() : nullptr;
+	std::size_t commonRows = baselineEntities ? std::min(entities.size(), baselineEntities->size()) : 0;
+
+	auto sameRow = [&](std::size_t index) { return index < commonRows && entities[index] == (*baselineEntities)[index]; };
+
+	if (from)
+	{
+		ForEachChangedRow(entities.data(), baselineEntities->data(), values, static_cast<const std::byte*>(from->GetDenseData()), info.size, commonRows,
+			[&](std::size_t index) { Set(info, entities[index], values + index * info.size); });
+	}
+
+	if (baselineEntities == &entities) return;
+
+	std::unordered_map<EntityID, std::size_t> before;
+
+	for (std::size_t index = 0; baselineEntities && index < baselineEntities->size(); index++)
+	{
+		if (!sameRow(index)) before.emplace((*baselineEntities)[index], index);
+	}
+
+	for (std::size_t index = 0; index < entities.size(); index++)
+	{
+		if (sameRow(index)) continue;
+
+		auto it = before.find(entities[index]);
+
+		if (it == before.end() || changed(*from, it->second, index)) Set(info, entities[index], values + index * info.size);
+		if (it != before.end()) before.erase(it);
+	}
+
+	for (const std::pair<const EntityID, std::size_t>& removed : before)
+	{
+		if (alive.IsAlive(removed.first)) Remove(info, removed.first);
+	}
+}
+
+void Weave::ECS::DeltaWriter::Set(const ComponentInfo& info, EntityID entity, const void* value)
+{
+	TypeChanges& changes = GetType(info.type);
+
+	changes.set.emplace_back(entity, changes.values.size());
+	WriteBytes(changes.values, value, info.size);
+}
+
+void Weave::ECS::DeltaWriter::Remove(const ComponentInfo& info, EntityID entity)
+{
+	GetType(info.type).removed.push_back(entity);
+}
+
+std::vector<std::byte> Weave::ECS::DeltaWriter::Finish(std::uint64_t baseline, std::uint64_t target)
+{
+	std::vector<std::byte> out;
+
+	DeltaHeader header{};
+	std::memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = Version;
+	header.byteOrder = ByteOrderMark;
+	header.baseline = baseline;
+	header.target = target;
+	WriteBytes(out, &header, sizeof(header));
+
+	std::sort(destroyed.begin(), destroyed.end());
+	std::sort(spawned.begin(), spawned.end());
+	WriteEntities(out, destroyed);
+	WriteEntities(out, spawned);
+
+	WriteVarint(out, types.size());
+	std::vector<EntityID> entities;
+
+	for (TypeChanges& changes : types)
+	{
+		WriteBytes(out, &changes.component->stableID, sizeof(std::uint64_t));
+		WriteBytes(out, &changes.component->layoutHash, sizeof(std::uint64_t));
+
+		std::sort(changes.removed.begin(), changes.removed.end());
+		WriteEntities(out, changes.removed);
+
+		std::sort(changes.set.begin(), changes.set.end());
+		entities.clear();
+		for (const std::pair<EntityID, std::size_t>& set : changes.set) entities.push_back(set.first);
+		WriteEntities(out, entities);
+
+		for (const std::pair<EntityID, std::size_t>& set : changes.set) WriteBytes(out, changes.values.data() + set.second, changes.component->info->size);
+	}
+
+	return out;
+}
+
+Weave::ECS::DeltaBatch::DeltaBatch(std::span<const std::byte> delta)
+{
+	DeltaReader reader(delta);
+
+	DeltaHeader header;
+	std::memcpy(&header, reader.Read(sizeof(header)), sizeof(header));
+
+	if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0) throw std::runtime_error("Data is not a Weave delta.");
+	if (header.byteOrder != ByteOrderMark) throw std::runtime_error("Delta was written on a platform with another byte order.");
+	if (header.version != Version) throw std::runtime_error("Delta version " + std::to_string(header.version) + " is not supported.");
+
+	baseline = header.baseline;
+	target = header.target;
+
+	std::vector<EntityID> destroyed;
+	reader.ReadEntities(destroyed);
+	reader.ReadEntities(spawned);
+
+	for (EntityID entity : destroyed) entityOps.push_back({ entity, ComponentOp{ nullptr, nullptr } });
+
+	// Values are copied out of the stream so every op points at a suitably aligned component.
+	struct TypeValues
+	{
+		const ComponentInfo* info;
+		const std::byte* source;
+		std::size_t firstOp;
+		std::size_t count;
+	};
+
+	std::vector<TypeValues> typeValues;
+	std::vector<EntityID> entities;
+	std::size_t valueBytes = 0;
+
+	ComponentRegistry& registry = ComponentRegistry::Get();
+	std::size_t typeCount = reader.ReadCount();
+
+	for (std::size_t type = 0; type < typeCount; type++)
+	{
+		std::uint64_t stableID;
+		std::uint64_t layoutHash;
+		std::memcpy(&stableID, reader.Read(sizeof(stableID)), sizeof(stableID));
+		std::memcpy(&layoutHash, reader.Read(sizeof(layoutHash)), sizeof(layoutHash));
+
+		const RegisteredComponent* registered = registry.Find(stableID);
+		if (!registered) throw std::runtime_error("Delta contains a component type that is not registered.");
+		if (registered->layoutHash != layoutHash) throw std::runtime_error("Layout of component " + registered->name + " differs from the sender's.");
+
+		const ComponentInfo* info = registered->info;
+		if (info->alignment > MaxAlignment) throw std::runtime_error("Component " + registered->name + " is aligned too strictly for deltas.");
+
+		reader.ReadEntities(entities);
+		for (EntityID entity : entities) entityOps.push_back({ entity, ComponentOp{ info, nullptr } });
+
+		reader.ReadEntities(entities);
+		if (info->size > 0 && entities.size() > (delta.size() / info->size)) DeltaReader::Corrupt();
+
+		typeValues.push_back({ info, reader.Read(entities.size() * info->size), entityOps.size(), entities.size() });
+		for (EntityID entity : entities) entityOps.push_back({ entity, ComponentOp{ info, nullptr } });
+
+		valueBytes = (valueBytes + info->alignment - 1) / info->alignment * info->alignment + entities.size() * info->size;
+	}
+
+	if (!reader.AtEnd()) DeltaReader::Corrupt();
+
+	values.reset(static_cast<std::byte*>(::operator new(valueBytes > 0 ? valueBytes : 1, std::align_val_t(MaxAlignment))));
+	std::size_t offset = 0;
+
+	for (const TypeValues& type : typeValues)
+	{
+		offset = (offset + type.info->alignment - 1) / type.info->alignment * type.info->alignment;
+		if (type.count > 0) std::memcpy(values.get() + offset, type.source, type.count * type.info->size);
+
+		for (std::size_t index = 0; index < type.count; index++) entityOps[type.firstOp + index].second.value = values.get() + offset + index * type.info->size;
+
+		offset += type.count * type.info->size;
+	}
+
+	// One transition per entity, a destroy sorts before the entity's other changes.
+	std::stable_sort(entityOps.begin(), entityOps.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+	ops.reserve(entityOps.size());
+	for (const std::pair<EntityID, ComponentOp>& entityOp : entityOps)
+	{
+		if (entityOp.second.info) ops.push_back(entityOp.second);
+	}
+
+	const ComponentOp* nextOp = ops.data();
+
+	for (std::size_t begin = 0; begin < entityOps.size();)
+	{
+		EntityID entity = entityOps[begin].first;
+		bool deleted = !entityOps[begin].second.info;
+
+		std::size_t end = begin;
+		while (end < entityOps.size() && entityOps[end].first == entity) end++;
+
+		std::size_t opCount = end - begin - (deleted ? 1 : 0);
+		transitions.push_back({ entity, deleted, std::span<const ComponentOp>(nextOp, opCount) });
+
+		nextOp += opCount;
+		begin = end;
+	}
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <vector>
+#include <span>
+#include <memory>
+#include <typeindex>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include "ComponentInfo.h"
+#include "ComponentRegistry.h"
+#include "EntityAllocator.h"
+#include "SparseSet/SparseSet.h"
+
+namespace Weave
+{
+	namespace ECS
+	{
+		// Calls onChanged(row) for each of the first rows that holds the same entity in both copies of a table but
+		// different bytes. Blocks without any change are skipped with one comparison of their entities and values.
+		template <typename F>
+		void ForEachChangedRow(const EntityID* entities, const EntityID* baselineEntities, const std::byte* values, const std::byte* baselineValues,
+			std::size_t size, std::size_t rows, F&& onChanged)
+		{
+			constexpr std::size_t BlockRows = 64;
+
+			for (std::size_t block = 0; block < rows; block += BlockRows)
+			{
+				std::size_t end = std::min(rows, block + BlockRows);
+
+				if (std::memcmp(entities + block, baselineEntities + block, (end - block) * sizeof(EntityID)) == 0
+					&& std::memcmp(values + block * size, baselineValues + block * size, (end - block) * size) == 0) continue;
+
+				for (std::size_t row = block; row < end; row++)
+				{
+					if (entities[row] == baselineEntities[row] && std::memcmp(values + row * size, baselineValues + row * size, size) != 0) onChanged(row);
+				}
+			}
+		}
+
+		// Collects the changes between two rollback snapshots and encodes them as a compact binary stream:
+		// destroyed and spawned entities, removed components and the components that were added or whose bytes
+		// changed. Entity IDs are sorted and stored as variable length differences. Every component type must be
+		// registered with the ComponentRegistry.
+		class DeltaWriter
+		{
+		private:
+			struct TypeChanges
+			{
+				const RegisteredComponent* component = nullptr;
+				std::vector<EntityID> removed;
+				std::vector<std::pair<EntityID, std::size_t>> set; // Entity and offset of its value in values.
+				std::vector<std::byte> values;
+			};
+
+			std::vector<EntityID> destroyed;
+			std::vector<EntityID> spawned;
+			std::vector<TypeChanges> types;
+			TypeChanges* lastType = nullptr;
+
+			TypeChanges& GetType(std::type_index type);
+
+		public:
+			// Compares which entities are alive, a null baseline is an empty world.
+			void AddEntityChanges(const EntityAllocator::State* from, const EntityAllocator::State& to);
+
+			// Compares two copies of one sparse set, components of destroyed entities are left to the destroy.
+			void AddSparseSetChanges(const SparseSetCopy* from, const SparseSetCopy& to, const EntityAllocator::State& alive);
+
+			void Set(const ComponentInfo& info, EntityID entity, const void* value);
+			void Remove(const ComponentInfo& info, EntityID entity);
+
+			std::vector<std::byte> Finish(std::uint64_t baseline, std::uint64_t target);
+		};
+
+		// A decoded delta, turned into one transition per entity so a World can apply it in batches.
+		class DeltaBatch
+		{
+		private:
+			struct AlignedDelete
+			{
+				void operator()(std::byte* data) const
+				{
+					::operator delete(data, std::align_val_t(MaxAlignment));
+				}
+			};
+
+			std::uint64_t baseline = 0;
+			std::uint64_t target = 0;
+			std::vector<EntityID> spawned;
+
+			std::unique_ptr<std::byte, AlignedDelete> values; // Component values the ops move from.
+			std::vector<std::pair<EntityID, ComponentOp>> entityOps;
+			std::vector<ComponentOp> ops;
+			std::vector<EntityTransition> transitions;
+
+		public:
+			// Decodes a stream from DeltaWriter, throws when it is corrupt or its component types aren't registered.
+			explicit DeltaBatch(std::span<const std::byte> delta);
+
+			std::uint64_t GetBaseline() const
+			{
+				return baseline;
+			}
+
+			std::uint64_t GetTarget() const
+			{
+				return target;
+			}
+
+			// Entities to make alive before the transitions are applied.
+			std::span<const EntityID> GetSpawned() const
+			{
+				return spawned;
+			}
+
+			std::span<const EntityTransition> GetTransitions() const
+			{
+				return transitions;
+			}
+
+			static constexpr std::size_t MaxAlignment = 64;
+		};
+	}
+}
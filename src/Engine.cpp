@@ -1,7 +1,9 @@
 #pragma once
 #include "Engine.h"
+#include <set>
 
-Weave::ECS::Engine::Engine(uint8_t threadCount) : threadPool(std::make_unique<Utilities::ThreadPool>(threadCount)) { }
+Weave::ECS::Engine::Engine(uint8_t threadCount, std::pmr::memory_resource* resource)
+    : world(resource), threadPool(std::make_unique<Utilities::ThreadPool>(threadCount)) { }
 
 Weave::ECS::World& Weave::ECS::Engine::GetWorld()
 {
@@ -31,20 +33,286 @@ void Weave::ECS::Engine::CallSystemGroup(SystemGroupID targetGroup)
     std::map<SystemGroupID, SystemGroup>::iterator it = systemGroups.find(targetGroup);
     if (it == systemGroups.end()) return;
 
-    SystemGroup& group = it->second;
-    if (group.dirty)
     {
-        std::sort(group.systems.begin(), group.systems.end(), [](const auto& a, const auto& b)
+        WEAVE_PROFILE_SCOPE("System Group");
+
+        SystemGroup& group = it->second;
+        if (group.dirty)
+        {
+            BuildSchedule(group);
+        }
+
+        for (std::size_t segment = 0; segment < group.segments.size(); segment++)
+        {
+            if (segment > 0) Sync(group, &group.segments[segment].access);
+            RunSegment(group, group.segments[segment]);
+        }
+
+        Sync(group, nullptr);
+
+        for (std::pair<const std::type_index, std::unique_ptr<IEventChannel>>& channel : eventChannels) channel.second->Swap();
+    }
+
+#ifdef WEAVE_ENABLE_PROFILING
+    // Walks all of the world's storage, so it is sampled outside the group's scope and only every few calls.
+    if (memoryCounterInterval > 0 && ++groupCallsSinceMemoryCounters >= memoryCounterInterval)
+    {
+        groupCallsSinceMemoryCounters = 0;
+        Utilities::RecordMemoryCounters(world.GetMemoryStats());
+    }
+#endif
+}
+
+void Weave::ECS::Engine::SetMemoryCounterInterval(std::uint32_t groupCalls)
+{
+    memoryCounterInterval = groupCalls;
+    groupCallsSinceMemoryCounters = 0;
+}
+
+void Weave::ECS::Engine::SetSyncMode(SystemGroupID groupID, SyncMode mode)
+{
+    SystemGroup& group = systemGroups[groupID];
+    group.syncMode = mode;
+    group.dirty = true;
+}
+
+void Weave::ECS::Engine::AddSyncPoint(SystemGroupID groupID, float priority)
+{
+    SystemGroup& group = systemGroups[groupID];
+    group.syncPoints.push_back(priority);
+    group.dirty = true;
+}
+
+Weave::ECS::SyncStats Weave::ECS::Engine::GetSyncStats(SystemGroupID groupID) const
+{
+    std::map<SystemGroupID, SystemGroup>::const_iterator it = systemGroups.find(groupID);
+    if (it == systemGroups.end()) return {};
+
+    return it->second.syncStats;
+}
+
+void Weave::ECS::Engine::Sync(SystemGroup& group, const SystemAccess* nextAccess)
+{
+    // Commands nothing in the next segment can see are left for a later sync point, the end of the group applies everything.
+    bool needed = nextAccess ? commandBuffer.Affects(*nextAccess) : !commandBuffer.IsEmpty();
+
+    if (!needed)
+    {
+        // Changes made directly on the world are still observed by the end of the group.
+        if (!nextAccess) world.NotifyObservers();
+
+        group.syncStats.skippedFlushes++;
+        return;
+    }
+
+    WEAVE_PROFILE_SCOPE("Flush");
+    commandBuffer.Flush(world);
+    group.syncStats.flushes++;
+}
+
+void Weave::ECS::Engine::BuildSchedule(SystemGroup& group)
+{
+    std::stable_sort(group.systems.begin(), group.systems.end(), [](const auto& a, const auto& b)
+        {
+            return a.priority > b.priority;
+        });
+
+    std::vector<float> syncPoints = group.syncPoints;
+    std::sort(syncPoints.begin(), syncPoints.end(), std::greater<float>());
+
+    std::size_t count = group.systems.size();
+    group.segments.clear();
+
+    // Structural access of the systems since the last sync point, their commands are not applied yet.
+    SystemAccess pending;
+    std::size_t nextSyncPoint = 0;
+
+    for (std::size_t index = 0; index < count; index++)
+    {
+        const SystemAccess& access = group.systems[index].access;
+        bool sync = false;
+
+        while (nextSyncPoint < syncPoints.size() && group.systems[index].priority <= syncPoints[nextSyncPoint])
+        {
+            sync = true;
+            nextSyncPoint++;
+        }
+
+        if (group.syncMode == SyncMode::Inferred && pending.StructurallyAffects(access)) sync = true;
+
+        if (group.segments.empty() || sync)
+        {
+            group.segments.push_back({ index, index, SystemAccess() });
+            pending = SystemAccess();
+        }
+
+        SystemSegment& segment = group.segments.back();
+        segment.end = index + 1;
+        segment.access.Merge(access);
+
+        if (access.structural) pending.Merge(access);
+    }
+
+    group.successors.assign(count, {});
+    group.dependencyCounts.assign(count, 0);
+
+    for (const SystemSegment& segment : group.segments)
+    {
+        for (std::size_t i = segment.begin; i < segment.end; i++)
+        {
+            for (std::size_t j = i + 1; j < segment.end; j++)
+            {
+                if (!group.systems[i].access.ConflictsWith(group.systems[j].access)) continue;
+
+                group.successors[i].push_back(j);
+                group.dependencyCounts[j]++;
+            }
+        }
+    }
+
+    group.dirty = false;
+}
+
+void Weave::ECS::Engine::RunSegment(SystemGroup& group, const SystemSegment& segment)
+{
+    std::size_t count = segment.end - segment.begin;
+    std::size_t completed = 0;
+
+    std::vector<std::size_t> remainingDependencies = group.dependencyCounts;
+    std::set<std::size_t> ready;
+    std::vector<std::pair<std::size_t, std::future<void>>> running;
+
+    for (std::size_t i = segment.begin; i < segment.end; i++)
+    {
+        if (remainingDependencies[i] == 0) ready.insert(i);
+    }
+
+    auto finishSystem = [&](std::size_t index)
+        {
+            completed++;
+
+            for (std::size_t successor : group.successors[index])
+            {
+                if (--remainingDependencies[successor] == 0) ready.insert(successor);
+            }
+        };
+
+    try
+    {
+        while (completed < count)
+        {
+            if (!ready.empty())
+            {
+                // Hand every ready system but the highest priority one to the pool, and run that one on this thread.
+                std::size_t localSystem = *ready.begin();
+                ready.erase(ready.begin());
+
+                for (std::size_t index : ready)
+                {
+                    running.emplace_back(index, threadPool->Enqueue([this, &group, index]() { ExecuteSystem(group, index); }));
+                }
+                ready.clear();
+
+                ExecuteSystem(group, localSystem);
+                finishSystem(localSystem);
+            }
+            else if (!threadPool->TryRunPendingTask())
+            {
+                std::this_thread::yield();
+            }
+
+            for (auto runningIt = running.begin(); runningIt != running.end();)
             {
-                return a.priority > b.priority;
-            });
+                if (runningIt->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                {
+                    ++runningIt;
+                    continue;
+                }
+
+                std::size_t index = runningIt->first;
+                runningIt->second.get();
+                runningIt = running.erase(runningIt);
+                finishSystem(index);
+            }
+        }
+    }
+    catch (...)
+    {
+        for (auto& [index, future] : running) threadPool->WaitFor(future);
+        throw;
+    }
+}
+
+void Weave::ECS::Engine::ExecuteSystem(SystemGroup& group, std::size_t index)
+{
+    System& system = group.systems[index];
+
+    WEAVE_PROFILE_SCOPE(system.profileName);
+    WEAVE_PERF_COUNTER_SCOPE(&system.counters->sink);
+    commandBuffer.BeginPhase(static_cast<std::uint32_t>(index));
+    std::size_t entities = system.executor->Execute(world);
+
+#ifdef WEAVE_ENABLE_PERF_COUNTERS
+    system.counters->executions++;
+    system.counters->entities += entities;
+#else
+    (void)entities;
+#endif
+}
+
+void Weave::ECS::Engine::SetSystemName(SystemID targetSystem, std::string_view name)
+{
+#ifdef WEAVE_ENABLE_PROFILING
+    std::unordered_map<SystemID, SystemGroupID>::iterator mapIt = systemToGroup.find(targetSystem);
+    if (mapIt == systemToGroup.end()) return;
+
+    for (System& system : systemGroups[mapIt->second].systems)
+    {
+        if (system.id == targetSystem) system.profileName = Utilities::Profiler::Get().Intern(name);
+    }
+#else
+    (void)targetSystem;
+    (void)name;
+#endif
+}
+
+Weave::ECS::SystemCounterStats Weave::ECS::Engine::GetSystemCounters(SystemID targetSystem) const
+{
+    SystemCounterStats stats;
+
+#ifdef WEAVE_ENABLE_PERF_COUNTERS
+    std::unordered_map<SystemID, SystemGroupID>::const_iterator mapIt = systemToGroup.find(targetSystem);
+    if (mapIt == systemToGroup.end()) return stats;
+
+    for (const System& system : systemGroups.at(mapIt->second).systems)
+    {
+        if (system.id != targetSystem) continue;
+
+        stats.available = Utilities::PerfCounters::IsAvailable();
+        stats.executions = system.counters->executions;
+        stats.entities = system.counters->entities;
+        stats.counters = system.counters->sink.Load();
     }
+#else
+    (void)targetSystem;
+#endif
 
-    for (const System& system : group.systems)
+    return stats;
+}
+
+void Weave::ECS::Engine::ResetSystemCounters()
+{
+#ifdef WEAVE_ENABLE_PERF_COUNTERS
+    for (auto& [groupID, group] : systemGroups)
     {
-        system.executor(world);
-        commandBuffer.Flush(world);
+        for (System& system : group.systems)
+        {
+            system.counters->sink.Reset();
+            system.counters->executions = 0;
+            system.counters->entities = 0;
+        }
     }
+#endif
 }
 
 void Weave::ECS::Engine::RetireSystem(SystemID targetSystem)
@@ -65,24 +333,79 @@ void Weave::ECS::Engine::RetireSystem(SystemID targetSystem)
     }
 }
 
-Weave::ECS::SystemID Weave::ECS::Engine::RegisterSystem(SystemGroupID groupID, std::function<void(World&, CommandBuffer&)> systemFn, float priority)
+Weave::ECS::SystemID Weave::ECS::Engine::RegisterSystem(SystemGroupID groupID, std::function<void(World&, CommandBuffer&)> systemFn, float priority, SystemAccess access)
+{
+    access.structural = true;
+
+    return AddSystem(groupID, [this, systemFn = std::move(systemFn)](World& world) { systemFn(world, commandBuffer); }, priority, std::move(access));
+}
+
+Weave::ECS::SystemID Weave::ECS::Engine::RegisterSystem(SystemGroupID groupID, std::function<void(World&)> systemFn, float priority, SystemAccess access)
 {
-    SystemID id = nextSystemID++;
+    return AddSystem(groupID, std::move(systemFn), priority, std::move(access));
+}
 
-    systemGroups[groupID].systems.push_back({ [this, systemFn](World& world) { systemFn(world, commandBuffer); }, id, priority });
-    systemGroups[groupID].dirty = true;
-    systemToGroup[id] = groupID;
+void Weave::ECS::Engine::PublishComponents()
+{
+    WEAVE_PROFILE_SCOPE("Publish");
 
-    return id;
+    for (std::pair<const std::type_index, std::unique_ptr<IPublishedComponents>>& published : publishedComponents)
+    {
+        published.second->Capture(world);
+        published.second->Swap();
+    }
 }
 
-Weave::ECS::SystemID Weave::ECS::Engine::RegisterSystem(SystemGroupID groupID, std::function<void(World&)> systemFn, float priority)
+void Weave::ECS::Engine::CallSystemGroupsPipelined(SystemGroupID simulationGroup, SystemGroupID publishedGroup)
 {
-    SystemID id = nextSystemID++;
+    std::map<SystemGroupID, SystemGroup>::iterator it = systemGroups.find(publishedGroup);
+    SystemGroup* group = it != systemGroups.end() ? &it->second : nullptr;
+
+    if (group)
+    {
+        if (group->dirty) BuildSchedule(*group);
+
+        for (const System& system : group->systems)
+        {
+            if (!system.published) throw std::logic_error("A pipelined group can only contain systems reading published components.");
+        }
+    }
+
+    if (group && !pipelineThread) pipelineThread = std::make_unique<Utilities::ThreadPool>(1);
 
-    systemGroups[groupID].systems.push_back({ std::move(systemFn), id, priority });
-    systemGroups[groupID].dirty = true;
-    systemToGroup[id] = groupID;
+    std::future<void> publishedRun;
+    if (group) publishedRun = pipelineThread->Enqueue([this, group]() { RunPublishedGroup(*group); });
 
-    return id;
-}
\ No newline at end of file
+    // The published group reads the front buffers, so the simulation's results can be captured into the back
+    // buffers before it finishes. They are only swapped in once it has.
+    try
+    {
+        CallSystemGroup(simulationGroup);
+
+        WEAVE_PROFILE_SCOPE("Publish");
+        for (std::pair<const std::type_index, std::unique_ptr<IPublishedComponents>>& published : publishedComponents) published.second->Capture(world);
+    }
+    catch (...)
+    {
+        if (publishedRun.valid()) pipelineThread->WaitFor(publishedRun);
+        throw;
+    }
+
+    if (publishedRun.valid())
+    {
+        pipelineThread->WaitFor(publishedRun);
+        publishedRun.get();
+    }
+
+    for (std::pair<const std::type_index, std::unique_ptr<IPublishedComponents>>& published : publishedComponents) published.second->Swap();
+}
+
+void Weave::ECS::Engine::RunPublishedGroup(SystemGroup& group)
+{
+    // Published systems don't record commands or touch the world, so they run in priority order without sync points.
+    for (System& system : group.systems)
+    {
+        WEAVE_PROFILE_SCOPE(system.profileName);
+        system.executor->Execute(world);
+    }
+}
@@ -2,9 +2,23 @@
 #include <map>
 #include <vector>
 #include <concepts>
+#include <string>
+#include <string_view>
+#include <memory_resource>
+#include <unordered_map>
+#include <typeindex>
+#include <mutex>
+#include <chrono>
 #include "ECS.h"
 #include "ThreadPool.h"
 #include "CommandBuffer.h"
+#include "EventChannel.h"
+#include "PublishedComponents.h"
+#include "StaticWorld.h"
+#include "SystemAccess.h"
+#include "SystemExecutor.h"
+#include "Profiler.h"
+#include "PerfCounters.h"
 
 namespace Weave
 {
@@ -21,24 +35,166 @@ namespace Weave
 			{ f(id, components..., cmd) } -> std::same_as<void>;
 		};
 
+		template <typename Component, typename Target>
+		using AccessArgument = std::conditional_t<std::same_as<Component, Target>, const Component&, Component&>;
+
+		// A component is only read when the system still accepts it as a const reference.
+		template<typename F, typename Target, typename... Components>
+		concept ReadsComponent = std::invocable<F&, EntityID, AccessArgument<Components, Target>...>
+			|| std::invocable<F&, EntityID, AccessArgument<Components, Target>..., CommandBuffer&>;
+
+		template<typename F, typename... Components>
+		SystemAccess InferSystemAccess()
+		{
+			SystemAccess access;
+
+			([&] {
+				if constexpr (ReadsComponent<F, Components, Components...>) access.Declare(static_cast<Read<Components>*>(nullptr));
+				else access.Declare(static_cast<Write<Components>*>(nullptr));
+				}(), ...);
+
+			return access;
+		}
+
+		// Hierarchy systems also get the parent's components, as const pointers that are null for entities without one.
+		template<typename F, typename... Components>
+		concept HierarchySystemFunction = requires(F && f, EntityID id, Components&... components, const Components*... parentComponents) {
+			{ f(id, components..., parentComponents...) } -> std::same_as<void>;
+		};
+
+		// Systems reading the components published by Engine::PublishComponents instead of the world.
+		template<typename F, typename... Components>
+		concept PublishedSystemFunction = requires(F && f, EntityID id, const Components&... components) {
+			{ f(id, components...) } -> std::same_as<void>;
+		};
+
+		template<typename F, typename Target, typename... Components>
+		concept HierarchyReadsComponent = std::invocable<F&, EntityID, AccessArgument<Components, Target>..., const Components*...>;
+
+		template<typename F, typename... Components>
+		SystemAccess InferHierarchySystemAccess()
+		{
+			SystemAccess access;
+
+			([&] {
+				if constexpr (HierarchyReadsComponent<F, Components, Components...>) access.Declare(static_cast<Read<Components>*>(nullptr));
+				else access.Declare(static_cast<Write<Components>*>(nullptr));
+				}(), ...);
+
+			return access;
+		}
+
 		using SystemGroupID = size_t;
 		using SystemID = size_t;
 
+		// Where a group applies buffered commands. Inferred places a sync point before every system that may see
+		// the changes of an earlier structural system, Explicit only syncs at points added with AddSyncPoint.
+		// Both always sync at the end of the group.
+		enum class SyncMode
+		{
+			Inferred,
+			Explicit
+		};
+
+		// How a time-sliced system spreads its entities over calls. A call processes at most 1/frames of them, and
+		// stops early once budget has passed unless the budget is zero.
+		struct TimeSlice
+		{
+			std::uint32_t frames = 1;
+			std::chrono::microseconds budget = std::chrono::microseconds::zero();
+		};
+
+		struct SyncStats
+		{
+			std::size_t flushes = 0;
+			std::size_t skippedFlushes = 0; // Sync points reached with no recorded command that the following systems could see.
+		};
+
+		// Hardware counters of one system summed over its executions, including the pool tasks it spread its work
+		// over. Only collected when WEAVE_ENABLE_PERF_COUNTERS is defined and the platform provides the counters.
+		struct SystemCounterStats
+		{
+			bool available = false;
+			std::size_t executions = 0;
+			std::size_t entities = 0; // Entities processed over all executions, 0 for systems taking the World directly.
+			Utilities::PerfCounterValues counters;
+
+			double GetIPC() const
+			{
+				return counters.cycles > 0 ? static_cast<double>(counters.instructions) / static_cast<double>(counters.cycles) : 0.0;
+			}
+
+			double GetL1DMissesPerEntity() const
+			{
+				return entities > 0 ? static_cast<double>(counters.l1dMisses) / static_cast<double>(entities) : 0.0;
+			}
+
+			double GetLLCMissesPerEntity() const
+			{
+				return entities > 0 ? static_cast<double>(counters.llcMisses) / static_cast<double>(entities) : 0.0;
+			}
+
+			double GetBranchMissesPerEntity() const
+			{
+				return entities > 0 ? static_cast<double>(counters.branchMisses) / static_cast<double>(entities) : 0.0;
+			}
+		};
+
 		class Engine
 		{
 		private:
+#ifdef WEAVE_ENABLE_PERF_COUNTERS
+			// Behind a pointer so systems stay movable while the schedule sorts them.
+			struct SystemCounters
+			{
+				Utilities::PerfCounterSink sink;
+				std::size_t executions = 0;
+				std::size_t entities = 0;
+			};
+#endif
+
 			struct System
 			{
-				std::function<void(World&)> executor;
+				std::unique_ptr<ISystemExecutor> executor;
+				SystemAccess access;
 
 				SystemID id;
 				float priority;
+
+				// Only reads published components, so it can run while another group changes the world.
+				bool published = false;
+
+#ifdef WEAVE_ENABLE_PROFILING
+				const char* profileName = nullptr;
+#endif
+
+#ifdef WEAVE_ENABLE_PERF_COUNTERS
+				std::unique_ptr<SystemCounters> counters = std::make_unique<SystemCounters>();
+#endif
+			};
+
+			// Systems between two sync points, access describes all of them together.
+			struct SystemSegment
+			{
+				std::size_t begin;
+				std::size_t end;
+				SystemAccess access;
 			};
 
 			struct SystemGroup 
 			{
 				std::vector<System> systems;
 				bool dirty = false;
+
+				SyncMode syncMode = SyncMode::Inferred;
+				std::vector<float> syncPoints;
+				SyncStats syncStats;
+
+				// Dependency graph over the priority sorted systems, an edge means the systems conflict and must run in priority order.
+				// Edges never cross a segment, segments run one after another with a sync point in between.
+				std::vector<std::vector<std::size_t>> successors;
+				std::vector<std::size_t> dependencyCounts;
+				std::vector<SystemSegment> segments;
 			};
 
 			World world;
@@ -52,8 +208,59 @@ namespace Weave
             std::unique_ptr<Utilities::ThreadPool> threadPool;
 			CommandBuffer commandBuffer;
 
+			std::unordered_map<std::type_index, std::unique_ptr<IEventChannel>> eventChannels;
+			std::mutex eventChannelMutex;
+
+			std::unordered_map<std::type_index, std::unique_ptr<IPublishedComponents>> publishedComponents;
+
+			// Runs the published group of CallSystemGroupsPipelined. A thread of its own, so the engine's pool never
+			// picks the whole group up while it waits for simulation work.
+			std::unique_ptr<Utilities::ThreadPool> pipelineThread;
+
+			std::uint32_t memoryCounterInterval = 0;
+			std::uint32_t groupCallsSinceMemoryCounters = 0;
+
+			template <typename Component>
+			const PublishedBuffer<Component>& GetPublishedBuffer() const
+			{
+				std::unordered_map<std::type_index, std::unique_ptr<IPublishedComponents>>::const_iterator it = publishedComponents.find(typeid(Component));
+				if (it == publishedComponents.end()) throw std::logic_error("Component type is not double-buffered.");
+
+				return static_cast<const PublishedComponents<Component>&>(*it->second).GetFront();
+			}
+
+			// Rows per task for threaded systems, large enough to amortize scheduling and small enough to balance.
+			size_t GetParallelChunkSize(size_t entityCount) const
+			{
+				return std::max<size_t>(64, entityCount / ((threadPool->GetThreadCount() + 1) * 4));
+			}
+
+			template <typename F>
+			SystemID AddSystem(SystemGroupID groupID, F&& executor, float priority, SystemAccess access)
+			{
+				SystemID id = nextSystemID++;
+
+				SystemGroup& group = systemGroups[groupID];
+				group.systems.push_back({ std::make_unique<SystemExecutor<std::decay_t<F>>>(std::forward<F>(executor)), std::move(access), id, priority });
+
+#ifdef WEAVE_ENABLE_PROFILING
+				group.systems.back().profileName = Utilities::Profiler::Get().Intern("System " + std::to_string(id));
+#endif
+				group.dirty = true;
+				systemToGroup[id] = groupID;
+
+				return id;
+			}
+
+			void BuildSchedule(SystemGroup& group);
+			void RunSegment(SystemGroup& group, const SystemSegment& segment);
+			void ExecuteSystem(SystemGroup& group, std::size_t index);
+			void Sync(SystemGroup& group, const SystemAccess* nextAccess);
+			void RunPublishedGroup(SystemGroup& group);
+
 		public:
-            Engine(uint8_t threadCount = std::thread::hardware_concurrency());
+            // The world's storage is allocated from resource, which must outlive the engine.
+            Engine(uint8_t threadCount = std::thread::hardware_concurrency(), std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
 			World& GetWorld();
 
@@ -61,140 +268,372 @@ namespace Weave
 			void RetireSystemGroup(SystemGroupID targetGroup);
 			void CallSystemGroup(SystemGroupID targetGroup);
 
+			void SetSyncMode(SystemGroupID groupID, SyncMode mode);
+			// Applies buffered commands after every system with a higher priority and before the rest.
+			void AddSyncPoint(SystemGroupID groupID, float priority);
+			SyncStats GetSyncStats(SystemGroupID groupID) const;
+
 			void RetireSystem(SystemID targetSystem);
 
-			SystemID RegisterSystem(SystemGroupID groupID, std::function<void(World&, CommandBuffer&)> systemFn, float priority = 0.0f);
-			SystemID RegisterSystem(SystemGroupID groupID, std::function<void(World&)> systemFn, float priority = 0.0f);
+			// Names the system in profiler traces, does nothing unless WEAVE_ENABLE_PROFILING is defined.
+			void SetSystemName(SystemID targetSystem, std::string_view name);
+
+			// Writes the world's memory totals to the profiler trace every groupCalls calls of CallSystemGroup, zero
+			// (the default) turns it off. Does nothing unless WEAVE_ENABLE_PROFILING is defined.
+			void SetMemoryCounterInterval(std::uint32_t groupCalls);
+
+			SystemCounterStats GetSystemCounters(SystemID targetSystem) const;
+			void ResetSystemCounters();
+
+			// Channel of events of type T, created on first use. Events written while a group runs are read
+			// during the next CallSystemGroup, every channel swaps when a group ends. Look the channel up once
+			// and keep the reference, writing and reading need no synchronization between systems.
+			template <typename T>
+			EventChannel<T>& GetEventChannel()
+			{
+				std::lock_guard<std::mutex> lock(eventChannelMutex);
+
+				std::unique_ptr<IEventChannel>& channel = eventChannels[typeid(T)];
+				if (!channel) channel = std::make_unique<EventChannel<T>>();
+
+				return static_cast<EventChannel<T>&>(*channel);
+			}
+
+			// Systems taking the World directly run on their own unless their component access is declared.
+			SystemID RegisterSystem(SystemGroupID groupID, std::function<void(World&, CommandBuffer&)> systemFn, float priority = 0.0f, SystemAccess access = SystemAccess::Exclusive());
+			SystemID RegisterSystem(SystemGroupID groupID, std::function<void(World&)> systemFn, float priority = 0.0f, SystemAccess access = SystemAccess::Exclusive());
 
 			template<typename... Components, SystemFunctionWithCommandBuffer<Components...> F>
 			SystemID RegisterSystem(SystemGroupID groupID, F&& systemFn, float priority = 0.0f) 
 			{
-				std::function<void(World&)> wrapper = [this, systemFn](World& world)
+				auto wrapper = [this, systemFn = std::forward<F>(systemFn)](World& world) mutable -> size_t
 					{
 						WorldView<Components...> view = world.GetView<Components...>();
 						size_t count = view.GetEntityCount();
-						if (count == 0) return;
+						if (count == 0) return 0;
 
-						for (auto entity : view)
-						{
-							std::apply([&systemFn, this](auto&&... args) {
-								systemFn(args..., this->commandBuffer);
-								}, entity);
-						}
+						CommandBuffer& cmdBuffer = this->commandBuffer;
+						std::uint32_t phase = cmdBuffer.GetPhase();
+
+						view.ForEach([&systemFn, &cmdBuffer, phase](EntityID entity, Components&... components) {
+							cmdBuffer.SetSortKey(phase, entity);
+							systemFn(entity, components..., cmdBuffer);
+							});
+
+						return count;
 					};
 
-				return RegisterSystem(groupID, wrapper, priority);
+				SystemAccess access = InferSystemAccess<F, Components...>();
+				access.structural = true;
+
+				return AddSystem(groupID, std::move(wrapper), priority, std::move(access));
 			}
 
 			template<typename... Components, SystemFunction<Components...> F>
 			SystemID RegisterSystem(SystemGroupID groupID, F&& systemFn, float priority = 0.0f) 
 			{
-				std::function<void(World&)> wrapper = [systemFn](World& world)
+				auto wrapper = [systemFn = std::forward<F>(systemFn)](World& world) mutable
 						{
 							WorldView<Components...> view = world.GetView<Components...>();
+							view.ForEach(systemFn);
 
-							size_t count = view.GetEntityCount();
-							if (count == 0) return;
-
-							for (auto entity : view)
-							{
-								std::apply(systemFn, entity);
-							}
+							return view.GetEntityCount();
 						};
 
-				return RegisterSystem(groupID, wrapper, priority);
+				return AddSystem(groupID, std::move(wrapper), priority, InferSystemAccess<F, Components...>());
+			}
+
+			// Per entity systems may leave out the component types, they are taken from the callable's parameters:
+			// RegisterSystem(group, [](EntityID entity, Position& position, const Velocity& velocity) { ... }).
+			template<DeducibleSystem F>
+			SystemID RegisterSystem(SystemGroupID groupID, F&& systemFn, float priority = 0.0f)
+			{
+				return [&]<typename... Components>(TypeList<Components...>*) {
+					return RegisterSystem<Components...>(groupID, std::forward<F>(systemFn), priority);
+				}(static_cast<typename CallableSignature<F>::Components*>(nullptr));
 			}
 
 			template<typename... Components, SystemFunctionWithCommandBuffer<Components...> F>
 			SystemID RegisterSystemThreaded(SystemGroupID groupID, F&& systemFn, float priority = 0.0f)
 			{
-				std::function<void(World&)> wrapper = [this, systemFn](World& world)
+				auto wrapper = [this, systemFn = std::forward<F>(systemFn)](World& world) -> size_t
 					{
 						WorldView<Components...> view = world.GetView<Components...>();
 						size_t count = view.GetEntityCount();
-						if (count == 0) return;
+						if (count == 0) return 0;
+
+						CommandBuffer& cmdBuffer = this->commandBuffer;
+						std::uint32_t phase = cmdBuffer.GetPhase();
+						std::vector<ViewChunk> chunks = view.Partition(this->GetParallelChunkSize(count));
+
+						this->threadPool->ParallelFor(chunks.size(), 1, [&view, &chunks, &systemFn, &cmdBuffer, phase](size_t start, size_t end) {
+							for (size_t i = start; i < end; i++) {
+								view.ForEach(chunks[i], [&systemFn, &cmdBuffer, phase](EntityID entity, Components&... components) {
+									cmdBuffer.SetSortKey(phase, entity);
+									systemFn(entity, components..., cmdBuffer);
+									});
+							}
+							});
 
-						size_t threads = this->threadPool->GetThreadCount();
+						return count;
+					};
 
-						if (count < threads)
+				SystemAccess access = InferSystemAccess<F, Components...>();
+				access.structural = true;
+
+				return AddSystem(groupID, std::move(wrapper), priority, std::move(access));
+			}
+
+			template<typename... Components, SystemFunction<Components...> F>
+            SystemID RegisterSystemThreaded(SystemGroupID groupID, F&& systemFn, float priority = 0.0f)
+            {
+				auto wrapper = [this, systemFn = std::forward<F>(systemFn)](World& world) -> size_t
 						{
-							for (auto entity : view)
-							{
-								std::apply([&systemFn, this](auto&&... args) {
-									systemFn(args..., this->commandBuffer);
-									}, entity);
-							}
+							WorldView<Components...> view = world.GetView<Components...>();
+							size_t count = view.GetEntityCount();
+							if (count == 0) return 0;
 
-							return;
-						}
+							std::vector<ViewChunk> chunks = view.Partition(this->GetParallelChunkSize(count));
 
-						size_t chunkSize = (count + threads - 1) / threads;
-						CommandBuffer& cmdBuffer = this->commandBuffer;
+							this->threadPool->ParallelFor(chunks.size(), 1, [&view, &chunks, &systemFn](size_t start, size_t end) {
+								for (size_t i = start; i < end; i++) {
+									view.ForEach(chunks[i], systemFn);
+								}
+								});
+
+							return count;
+						};
+
+                return AddSystem(groupID, std::move(wrapper), priority, InferSystemAccess<F, Components...>());
+            }
+
+			template<DeducibleSystem F>
+			SystemID RegisterSystemThreaded(SystemGroupID groupID, F&& systemFn, float priority = 0.0f)
+			{
+				return [&]<typename... Components>(TypeList<Components...>*) {
+					return RegisterSystemThreaded<Components...>(groupID, std::forward<F>(systemFn), priority);
+				}(static_cast<typename CallableSignature<F>::Components*>(nullptr));
+			}
+
+			// Per entity systems over a StaticWorld, scheduled with the engine's other systems. Access is declared by
+			// component type, so they conflict with systems of the engine's world that use the same types. The
+			// world must outlive its systems, and its structural changes aren't buffered.
+			template<typename... Components, typename... WorldComponents, SystemFunction<Components...> F>
+			SystemID RegisterSystem(SystemGroupID groupID, StaticWorld<WorldComponents...>& targetWorld, F&& systemFn, float priority = 0.0f)
+			{
+				auto wrapper = [&targetWorld, systemFn = std::forward<F>(systemFn)](World&) mutable
+						{
+							StaticWorldView<Components...> view = targetWorld.template GetView<Components...>();
+							view.ForEach(systemFn);
 
-						for (size_t t = 0; t < threads; t++) {
-							size_t start = t * chunkSize;
-							size_t end = std::min(start + chunkSize, count - 1);
+							return view.GetEntityCount();
+						};
 
-							this->threadPool->Enqueue([&view, start, end, &systemFn, &cmdBuffer]() {
-								auto it = view.at(start);
-								auto endIt = view.at(end);
+				return AddSystem(groupID, std::move(wrapper), priority, InferSystemAccess<F, Components...>());
+			}
 
-								while (it != endIt) {
-									std::apply([&systemFn, &cmdBuffer](auto&&... args) { systemFn(args..., cmdBuffer); }, *it);
-									++it;
+			template<DeducibleSystem F, typename... WorldComponents>
+			SystemID RegisterSystem(SystemGroupID groupID, StaticWorld<WorldComponents...>& targetWorld, F&& systemFn, float priority = 0.0f)
+			{
+				return [&]<typename... Components>(TypeList<Components...>*) {
+					return RegisterSystem<Components...>(groupID, targetWorld, std::forward<F>(systemFn), priority);
+				}(static_cast<typename CallableSignature<F>::Components*>(nullptr));
+			}
+
+			template<typename... Components, typename... WorldComponents, SystemFunction<Components...> F>
+			SystemID RegisterSystemThreaded(SystemGroupID groupID, StaticWorld<WorldComponents...>& targetWorld, F&& systemFn, float priority = 0.0f)
+			{
+				auto wrapper = [this, &targetWorld, systemFn = std::forward<F>(systemFn)](World&) -> size_t
+						{
+							StaticWorldView<Components...> view = targetWorld.template GetView<Components...>();
+							size_t count = view.GetEntityCount();
+							if (count == 0) return 0;
+
+							std::vector<ViewChunk> chunks = view.Partition(this->GetParallelChunkSize(count));
+
+							this->threadPool->ParallelFor(chunks.size(), 1, [&view, &chunks, &systemFn](size_t start, size_t end) {
+								for (size_t i = start; i < end; i++) {
+									view.ForEach(chunks[i], systemFn);
 								}
 								});
-						}
 
-						this->threadPool->WaitAll();
+							return count;
+						};
+
+				return AddSystem(groupID, std::move(wrapper), priority, InferSystemAccess<F, Components...>());
+			}
+
+			template<DeducibleSystem F, typename... WorldComponents>
+			SystemID RegisterSystemThreaded(SystemGroupID groupID, StaticWorld<WorldComponents...>& targetWorld, F&& systemFn, float priority = 0.0f)
+			{
+				return [&]<typename... Components>(TypeList<Components...>*) {
+					return RegisterSystemThreaded<Components...>(groupID, targetWorld, std::forward<F>(systemFn), priority);
+				}(static_cast<typename CallableSignature<F>::Components*>(nullptr));
+			}
+
+			// Keeps a published copy of the component types, refreshed by PublishComponents. Systems registered with
+			// RegisterPublishedSystem read the copy, so they can run while the world is being changed.
+			template <typename... Components>
+			void DoubleBuffer()
+			{
+				([&] {
+					std::unique_ptr<IPublishedComponents>& published = publishedComponents[typeid(Components)];
+					if (!published) published = std::make_unique<PublishedComponents<Components>>();
+					}(), ...);
+			}
+
+			// Copies every double-buffered component of the world and publishes the copies. Must not run while
+			// systems change those components or published systems run.
+			void PublishComponents();
+
+			// Runs simulationGroup on the world while publishedGroup runs on another thread with the components
+			// published by the previous call, then publishes the simulation's results. publishedGroup may only
+			// contain systems registered with RegisterPublishedSystem, which throws otherwise.
+			void CallSystemGroupsPipelined(SystemGroupID simulationGroup, SystemGroupID publishedGroup);
+
+			// Values of the components when they were last published. Throws for types that aren't double-buffered.
+			template <typename... Components>
+			PublishedView<Components...> GetPublishedView() const
+			{
+				return PublishedView<Components...>(GetPublishedBuffer<Components>()...);
+			}
+
+			// Per entity system over the published copies of double-buffered components, see DoubleBuffer.
+			template<typename... Components, PublishedSystemFunction<Components...> F>
+			SystemID RegisterPublishedSystem(SystemGroupID groupID, F&& systemFn, float priority = 0.0f)
+			{
+				(GetPublishedBuffer<Components>(), ...);
+
+				auto wrapper = [this, systemFn = std::forward<F>(systemFn)](World&) mutable -> size_t
+					{
+						PublishedView<Components...> view = this->GetPublishedView<Components...>();
+						size_t count = 0;
+
+						view.ForEach([&systemFn, &count](EntityID entity, const Components&... components) {
+							systemFn(entity, components...);
+							count++;
+							});
+
+						return count;
 					};
 
-				return RegisterSystem(groupID, wrapper, priority);
+				SystemID id = AddSystem(groupID, std::move(wrapper), priority, SystemAccess());
+				systemGroups[groupID].systems.back().published = true;
+
+				return id;
 			}
 
-			template<typename... Components, SystemFunction<Components...> F>
-            SystemID RegisterSystemThreaded(SystemGroupID groupID, F&& systemFn, float priority = 0.0f)
-            {
-				std::function<void(World&)> wrapper = [this, systemFn](World& world)
+			template<DeducibleSystem F>
+			SystemID RegisterPublishedSystem(SystemGroupID groupID, F&& systemFn, float priority = 0.0f)
+			{
+				return [&]<typename... Components>(TypeList<Components...>*) {
+					return RegisterPublishedSystem<Components...>(groupID, std::forward<F>(systemFn), priority);
+				}(static_cast<typename CallableSignature<F>::Components*>(nullptr));
+			}
+
+			// Runs systemFn over part of its entities per call, resuming where the previous call stopped. A cycle visits
+			// the entities that matched when it started, by ID, so structural changes during the cycle neither skip nor
+			// repeat any of them: entities that lost a component are passed over and those that gained one join the next
+			// cycle. Only the call that starts a cycle builds a view.
+			template<typename... Components, typename F>
+				requires SystemFunction<F, Components...> || SystemFunctionWithCommandBuffer<F, Components...>
+			SystemID RegisterSystemSliced(SystemGroupID groupID, F&& systemFn, TimeSlice slice, float priority = 0.0f)
+			{
+				if (slice.frames == 0) throw std::invalid_argument("A time slice needs at least one frame.");
+
+				auto wrapper = [this, systemFn = std::forward<F>(systemFn), slice, cycle = std::vector<EntityID>(), cursor = size_t(0), quota = size_t(0)](World& world) mutable -> size_t
+					{
+						if (cursor >= cycle.size())
 						{
+							cycle.clear();
+							cursor = 0;
+
 							WorldView<Components...> view = world.GetView<Components...>();
-							size_t count = view.GetEntityCount();
-							if (count == 0) return;
+							cycle.reserve(view.GetEntityCount());
+							view.ForEach([&cycle](EntityID entity, const Components&...) { cycle.push_back(entity); });
+
+							quota = (cycle.size() + slice.frames - 1) / slice.frames;
+						}
+
+						size_t end = std::min(cycle.size(), cursor + quota);
+						size_t processed = 0;
+
+						CommandBuffer& cmdBuffer = this->commandBuffer;
+						std::uint32_t phase = cmdBuffer.GetPhase();
+
+						// The clock is read between small batches, so the budget is overrun by at most one batch.
+						constexpr size_t BatchSize = 32;
+						bool budgeted = slice.budget != std::chrono::microseconds::zero();
+						std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + slice.budget;
 
-							size_t threads = this->threadPool->GetThreadCount();
+						while (cursor < end)
+						{
+							size_t batchEnd = budgeted ? std::min(end, cursor + BatchSize) : end;
 
-							if (count < threads)
+							for (; cursor < batchEnd; cursor++)
 							{
-								for (auto entity : view)
+								EntityID entity = cycle[cursor];
+								std::tuple<Components*...> components(world.TryGetComponent<Components>(entity)...);
+
+								if ((!std::get<Components*>(components) || ...)) continue;
+
+								if constexpr (SystemFunctionWithCommandBuffer<F, Components...>)
+								{
+									cmdBuffer.SetSortKey(phase, entity);
+									systemFn(entity, *std::get<Components*>(components)..., cmdBuffer);
+								}
+								else
 								{
-									std::apply(systemFn, entity);
+									systemFn(entity, *std::get<Components*>(components)...);
 								}
 
-								return;
+								processed++;
 							}
 
-							size_t chunkSize = (count + threads - 1) / threads;
+							if (budgeted && std::chrono::steady_clock::now() >= deadline) break;
+						}
 
-							for (size_t t = 0; t < threads; t++) {
-								size_t start = t * chunkSize;
-								size_t end = std::min(start + chunkSize, count - 1);
+						return processed;
+					};
 
-								this->threadPool->Enqueue([&view, start, end, &systemFn]() {
-									auto it = view.at(start);
-									auto endIt = view.at(end);
+				SystemAccess access = InferSystemAccess<F, Components...>();
+				if constexpr (SystemFunctionWithCommandBuffer<F, Components...>) access.structural = true;
 
-									while (it != endIt) {
-										std::apply(systemFn, *it);
-										++it;
-									}
-									});
-							}
+				return AddSystem(groupID, std::move(wrapper), priority, std::move(access));
+			}
 
-							this->threadPool->WaitAll();
-						};
+			template<DeducibleSystem F>
+			SystemID RegisterSystemSliced(SystemGroupID groupID, F&& systemFn, TimeSlice slice, float priority = 0.0f)
+			{
+				return [&]<typename... Components>(TypeList<Components...>*) {
+					return RegisterSystemSliced<Components...>(groupID, std::forward<F>(systemFn), slice, priority);
+				}(static_cast<typename CallableSignature<F>::Components*>(nullptr));
+			}
 
-                return RegisterSystem(groupID, wrapper, priority);
-            }
+			// Runs systemFn over the entities of every hierarchy with the components, parents before their children,
+			// so values such as transforms can be propagated down in one pass. Each depth is split over the thread pool.
+			template<typename... Components, HierarchySystemFunction<Components...> F>
+			SystemID RegisterHierarchySystem(SystemGroupID groupID, F&& systemFn, float priority = 0.0f)
+			{
+				auto wrapper = [this, systemFn = std::forward<F>(systemFn)](World& world) -> size_t
+					{
+						HierarchyView<Components...> view = world.GetHierarchyView<Components...>();
+
+						for (size_t depth = 0; depth < view.GetDepthCount(); depth++)
+						{
+							size_t begin = view.GetLevelBegin(depth);
+							size_t count = view.GetLevelEnd(depth) - begin;
+
+							this->threadPool->ParallelFor(count, this->GetParallelChunkSize(count), [&view, &systemFn, begin](size_t start, size_t end) {
+								view.ForEach(begin + start, begin + end, systemFn);
+								});
+						}
+
+						return view.GetEntityCount();
+					};
+
+				return AddSystem(groupID, std::move(wrapper), priority, InferHierarchySystemAccess<F, Components...>());
+			}
 		};
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,260 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <span>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace Weave
+{
+	namespace ECS
+	{
+		using EntityID = std::size_t;
+
+		// Hands out entity IDs, reusing freed ones. Reserve is lock-free and may be called from any number of
+		// threads at once, as long as nothing allocates, frees or flushes at the same time. Reserved IDs become
+		// alive on the next FlushReserved.
+		class EntityAllocator
+		{
+		public:
+			struct State
+			{
+				std::vector<EntityID> freeIDs;
+				std::vector<std::uint64_t> alive; // One bit per ID, bits from nextID on are zero.
+				EntityID nextID = 0;
+
+				bool IsAlive(EntityID entity) const
+				{
+					return entity < nextID && (alive[entity / 64] >> (entity % 64) & 1);
+				}
+			};
+
+		private:
+			std::vector<EntityID> freeIDs;
+			std::vector<std::uint64_t> alive;
+			EntityID nextID = 0;
+
+			void SetAlive(EntityID entity, bool isAlive)
+			{
+				if (entity / 64 >= alive.size()) alive.resize(entity / 64 + 1, 0);
+
+				std::uint64_t bit = std::uint64_t(1) << (entity % 64);
+				alive[entity / 64] = isAlive ? alive[entity / 64] | bit : alive[entity / 64] & ~bit;
+			}
+
+			// Set by every change, cleared by Capture and Restore.
+			bool modified = true;
+			std::shared_ptr<const State> capture;
+
+			// freeIDs[0, cursor) are not reserved yet, a negative cursor counts IDs reserved past nextID.
+			std::atomic<std::int64_t> freeCursor = 0;
+
+		public:
+			EntityID Reserve()
+			{
+				std::int64_t cursor = freeCursor.fetch_sub(1, std::memory_order_relaxed);
+
+				if (cursor > 0) return freeIDs[cursor - 1];
+
+				return nextID + static_cast<EntityID>(-cursor);
+			}
+
+			bool HasReserved() const
+			{
+				return freeCursor.load(std::memory_order_relaxed) != static_cast<std::int64_t>(freeIDs.size());
+			}
+
+			// Makes every reserved ID alive, onReserved(entity) is called for each of them.
+			template <typename F>
+			void FlushReserved(F&& onReserved)
+			{
+				std::int64_t cursor = freeCursor.load(std::memory_order_relaxed);
+				std::size_t remaining = cursor > 0 ? static_cast<std::size_t>(cursor) : 0;
+				modified = true;
+
+				for (std::size_t index = freeIDs.size(); index > remaining; index--)
+				{
+					SetAlive(freeIDs[index - 1], true);
+					onReserved(freeIDs[index - 1]);
+				}
+
+				freeIDs.resize(remaining);
+
+				if (cursor < 0)
+				{
+					EntityID end = nextID + static_cast<EntityID>(-cursor);
+					for (EntityID entity = nextID; entity < end; entity++)
+					{
+						SetAlive(entity, true);
+						onReserved(entity);
+					}
+
+					nextID = end;
+				}
+
+				freeCursor.store(static_cast<std::int64_t>(freeIDs.size()), std::memory_order_relaxed);
+			}
+
+			void FlushReserved()
+			{
+				FlushReserved([](EntityID) {});
+			}
+
+			// Reserved IDs must be flushed first.
+			EntityID Allocate()
+			{
+				EntityID entity;
+				modified = true;
+
+				if (!freeIDs.empty())
+				{
+					entity = freeIDs.back();
+					freeIDs.pop_back();
+				}
+				else
+				{
+					entity = nextID++;
+				}
+
+				SetAlive(entity, true);
+
+				freeCursor.store(static_cast<std::int64_t>(freeIDs.size()), std::memory_order_relaxed);
+
+				return entity;
+			}
+
+			// Reserved IDs must be flushed first.
+			void Free(EntityID entity)
+			{
+				modified = true;
+				SetAlive(entity, false);
+				freeIDs.push_back(entity);
+
+				freeCursor.store(static_cast<std::int64_t>(freeIDs.size()), std::memory_order_relaxed);
+			}
+
+			// Makes a specific free or never used ID alive, for worlds that mirror the IDs of another world.
+			// Throws unless reserved IDs were flushed first, since the free IDs they were taken from would move.
+			void Claim(EntityID entity)
+			{
+				if (HasReserved()) throw std::logic_error("Reserved entity IDs must be flushed before claiming one.");
+				if (IsAlive(entity)) throw std::runtime_error("Entity " + std::to_string(entity) + " is already alive.");
+
+				modified = true;
+
+				if (entity >= nextID)
+				{
+					for (EntityID skipped = nextID; skipped < entity; skipped++) freeIDs.push_back(skipped);
+
+					nextID = entity + 1;
+				}
+				else
+				{
+					// Mirrored worlds reuse IDs in the same order, so the ID is usually near the back. Erasing keeps
+					// the order of the others, so both worlds go on reusing them alike.
+					auto it = std::find(freeIDs.rbegin(), freeIDs.rend(), entity);
+					if (it == freeIDs.rend()) throw std::runtime_error("Entity " + std::to_string(entity) + " is neither alive nor free.");
+
+					freeIDs.erase(std::next(it).base());
+				}
+
+				SetAlive(entity, true);
+				freeCursor.store(static_cast<std::int64_t>(freeIDs.size()), std::memory_order_relaxed);
+			}
+
+			bool IsAlive(EntityID entity) const
+			{
+				return entity < nextID && (alive[entity / 64] >> (entity % 64) & 1);
+			}
+
+			// Replaces all state, every ID below next that isn't free is alive. Reserved IDs must be flushed first.
+			void Restore(EntityID next, std::span<const EntityID> free)
+			{
+				modified = true;
+				alive.assign((next + 63) / 64, ~std::uint64_t(0));
+				if (next % 64 != 0) alive.back() = (std::uint64_t(1) << (next % 64)) - 1;
+
+				nextID = next;
+
+				for (EntityID entity : free)
+				{
+					if (!IsAlive(entity)) throw std::runtime_error("Free entity IDs are out of range or repeated.");
+					SetAlive(entity, false);
+				}
+
+				freeIDs.assign(free.begin(), free.end());
+
+				freeCursor.store(static_cast<std::int64_t>(freeIDs.size()), std::memory_order_relaxed);
+			}
+
+			// Copies the state for rollback, or returns the last copy while nothing changed since it was captured or
+			// restored. reuse is an older copy whose memory is reused when nothing else shares it. Reserved IDs must be flushed first.
+			std::shared_ptr<const State> Capture(std::shared_ptr<const State> reuse)
+			{
+				if (!modified && capture) return capture;
+
+				capture.reset();
+
+				std::shared_ptr<State> state = std::const_pointer_cast<State>(std::move(reuse));
+				if (!state || state.use_count() != 1) state = std::make_shared<State>();
+
+				state->freeIDs.assign(freeIDs.begin(), freeIDs.end());
+				state->alive.assign(alive.begin(), alive.end());
+				state->nextID = nextID;
+
+				capture = std::move(state);
+				modified = false;
+
+				return capture;
+			}
+
+			// Returns to a state from Capture. Reserved IDs must be flushed first.
+			void Restore(const std::shared_ptr<const State>& state)
+			{
+				if (state == capture && !modified) return;
+
+				freeIDs.assign(state->freeIDs.begin(), state->freeIDs.end());
+				alive.assign(state->alive.begin(), state->alive.end());
+				nextID = state->nextID;
+
+				freeCursor.store(static_cast<std::int64_t>(freeIDs.size()), std::memory_order_relaxed);
+
+				capture = state;
+				modified = false;
+			}
+
+			std::span<const EntityID> GetFreeIDs() const
+			{
+				return freeIDs;
+			}
+
+			// Entities that were allocated or flushed and not freed since, reserved IDs don't count until flushed.
+			std::size_t GetAliveCount() const
+			{
+				return nextID - freeIDs.size();
+			}
+
+			std::size_t GetFreeCount() const
+			{
+				return freeIDs.size();
+			}
+
+			std::size_t GetAllocatedBytes() const
+			{
+				return freeIDs.capacity() * sizeof(EntityID) + alive.capacity() * sizeof(std::uint64_t);
+			}
+
+			// Upper bound of every ID handed out so far, including reserved ones.
+			EntityID GetCapacity() const
+			{
+				std::int64_t cursor = freeCursor.load(std::memory_order_relaxed);
+				return cursor < 0 ? nextID + static_cast<EntityID>(-cursor) : nextID;
+			}
+		};
+	}
+}
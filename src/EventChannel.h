@@ -0,0 +1,112 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <span>
+#include <iterator>
+#include <utility>
+#include <stdexcept>
+#include <cstddef>
+#include "ThreadSlot.h"
+
+namespace Weave
+{
+	namespace ECS
+	{
+		class IEventChannel
+		{
+		public:
+			virtual ~IEventChannel() = default;
+
+			virtual void Swap() = 0;
+		};
+
+		// Typed events passed between systems without creating entities. Writers append to a buffer of their own
+		// thread, so systems on the thread pool write without locking. Swap gathers everything written into one
+		// contiguous array that readers see until the next Swap, the Engine swaps at the end of every
+		// CallSystemGroup. Events of one thread keep their order, the order between threads is unspecified.
+		template <typename T>
+		class EventChannel : public IEventChannel
+		{
+		private:
+			static constexpr std::size_t MaxThreads = 1024;
+
+			// Aligned so threads appending to neighbouring buffers don't share a cache line.
+			struct alignas(64) ThreadEvents
+			{
+				std::vector<T> events;
+			};
+
+			std::unique_ptr<std::atomic<ThreadEvents*>[]> threadEvents = std::make_unique<std::atomic<ThreadEvents*>[]>(MaxThreads);
+			std::mutex creationMutex;
+			std::vector<std::unique_ptr<ThreadEvents>> ownedEvents;
+
+			std::vector<T> readable;
+
+			std::vector<T>& GetThreadEvents()
+			{
+				std::size_t slot = Utilities::ThreadSlot::Current();
+				if (slot >= MaxThreads) throw std::runtime_error("Too many threads writing to an EventChannel.");
+
+				ThreadEvents* events = threadEvents[slot].load(std::memory_order_acquire);
+				if (events) return events->events;
+
+				std::lock_guard<std::mutex> lock(creationMutex);
+				ownedEvents.push_back(std::make_unique<ThreadEvents>());
+				events = ownedEvents.back().get();
+				threadEvents[slot].store(events, std::memory_order_release);
+
+				return events->events;
+			}
+
+		public:
+			EventChannel() = default;
+			EventChannel(const EventChannel&) = delete;
+			EventChannel& operator=(const EventChannel&) = delete;
+
+			// Safe to call from any thread while systems run.
+			void Write(T event)
+			{
+				GetThreadEvents().push_back(std::move(event));
+			}
+
+			template <typename... Args>
+			void Emplace(Args&&... args)
+			{
+				GetThreadEvents().emplace_back(std::forward<Args>(args)...);
+			}
+
+			// Events written before the last Swap. The span stays valid until the next Swap.
+			std::span<const T> Read() const
+			{
+				return readable;
+			}
+
+			// Must not run while other threads write. Buffers keep their capacity, so a channel that carries a
+			// similar number of events every frame stops allocating.
+			void Swap() override
+			{
+				readable.clear();
+
+				std::lock_guard<std::mutex> lock(creationMutex);
+
+				for (std::unique_ptr<ThreadEvents>& events : ownedEvents)
+				{
+					readable.insert(readable.end(), std::make_move_iterator(events->events.begin()), std::make_move_iterator(events->events.end()));
+					events->events.clear();
+				}
+			}
+
+			// Drops both the readable events and those written since the last Swap. The Engine never clears
+			// channels, they are shared by every system group.
+			void Clear()
+			{
+				readable.clear();
+
+				std::lock_guard<std::mutex> lock(creationMutex);
+				for (std::unique_ptr<ThreadEvents>& events : ownedEvents) events->events.clear();
+			}
+		};
+	}
+}
@@ -0,0 +1,379 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <memory_resource>
+#include <tuple>
+#include <utility>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+
+namespace Weave
+{
+	namespace ECS
+	{
+		using EntityID = std::size_t;
+
+		// Stands for no entity, such as the parent of a root.
+		inline constexpr EntityID NoEntity = std::numeric_limits<EntityID>::max();
+
+		// Every entity of a World's hierarchies by depth: roots first, then their children in order, and so on.
+		struct HierarchyOrder
+		{
+			std::vector<EntityID> entities;
+			std::vector<std::size_t> parents; // Index of each entity's parent in entities, NoEntity for roots.
+			std::vector<std::size_t> levels;  // Offset of each depth in entities, followed by entities.size().
+		};
+
+		// Parent and child links between entities. Children are kept in a list through their siblings, in the order
+		// they were parented. Deleting an entity detaches it and turns its children into roots.
+		class Hierarchy
+		{
+		public:
+			struct Node
+			{
+				EntityID parent = NoEntity;
+				EntityID firstChild = NoEntity;
+				EntityID lastChild = NoEntity;
+				EntityID previousSibling = NoEntity;
+				EntityID nextSibling = NoEntity;
+				std::size_t childCount = 0;
+			};
+
+			struct State
+			{
+				std::vector<Node> nodes;
+			};
+
+			// The children of one entity, iterated through their sibling links.
+			class Children
+			{
+			private:
+				const std::vector<Node>* nodes;
+				EntityID first;
+				std::size_t count;
+
+			public:
+				Children(const std::vector<Node>* nodes, EntityID first, std::size_t count)
+					: nodes(nodes), first(first), count(count) {}
+
+				class Iterator
+				{
+				private:
+					const std::vector<Node>* nodes;
+					EntityID entity;
+
+				public:
+					Iterator(const std::vector<Node>* nodes, EntityID entity)
+						: nodes(nodes), entity(entity) {}
+
+					EntityID operator*() const
+					{
+						return entity;
+					}
+
+					Iterator& operator++()
+					{
+						entity = (*nodes)[entity].nextSibling;
+						return *this;
+					}
+
+					bool operator!=(const Iterator& other) const
+					{
+						return entity != other.entity;
+					}
+				};
+
+				Iterator begin() const { return Iterator(nodes, first); }
+				Iterator end() const { return Iterator(nodes, NoEntity); }
+
+				std::size_t size() const
+				{
+					return count;
+				}
+			};
+
+		private:
+			std::vector<Node> nodes;
+
+			// Incremented by every change, so cached depth orders can tell they are stale.
+			std::uint64_t version = 0;
+
+			// Set by every change, cleared by Capture and Restore.
+			bool modified = true;
+			std::shared_ptr<const State> capture;
+
+			Node& GetNode(EntityID entity)
+			{
+				if (entity >= nodes.size()) nodes.resize(entity + 1);
+				return nodes[entity];
+			}
+
+			void Changed()
+			{
+				version++;
+				modified = true;
+			}
+
+			void Detach(EntityID child)
+			{
+				Node& node = nodes[child];
+				Node& parent = nodes[node.parent];
+
+				if (node.previousSibling != NoEntity) nodes[node.previousSibling].nextSibling = node.nextSibling;
+				else parent.firstChild = node.nextSibling;
+
+				if (node.nextSibling != NoEntity) nodes[node.nextSibling].previousSibling = node.previousSibling;
+				else parent.lastChild = node.previousSibling;
+
+				parent.childCount--;
+				node.parent = NoEntity;
+				node.previousSibling = NoEntity;
+				node.nextSibling = NoEntity;
+			}
+
+		public:
+			// Makes child the last child of parent, moving it from its current parent. Throws when child is parent
+			// or one of its ancestors.
+			void SetParent(EntityID child, EntityID parent)
+			{
+				for (EntityID ancestor = parent; ancestor != NoEntity; ancestor = GetParent(ancestor))
+				{
+					if (ancestor == child) throw std::logic_error("An entity can't be parented to itself or its descendants.");
+				}
+
+				GetNode(std::max(child, parent));
+				if (nodes[child].parent == parent) return;
+
+				if (nodes[child].parent != NoEntity) Detach(child);
+
+				Node& node = nodes[child];
+				Node& parentNode = nodes[parent];
+
+				node.parent = parent;
+				node.previousSibling = parentNode.lastChild;
+
+				if (parentNode.lastChild != NoEntity) nodes[parentNode.lastChild].nextSibling = child;
+				else parentNode.firstChild = child;
+
+				parentNode.lastChild = child;
+				parentNode.childCount++;
+
+				Changed();
+			}
+
+			void RemoveParent(EntityID child)
+			{
+				if (GetParent(child) == NoEntity) return;
+
+				Detach(child);
+				Changed();
+			}
+
+			// Unlinks an entity that is deleted, its children become roots.
+			void Remove(EntityID entity)
+			{
+				if (entity >= nodes.size()) return;
+
+				Node& node = nodes[entity];
+				if (node.parent == NoEntity && node.firstChild == NoEntity) return;
+
+				if (node.parent != NoEntity) Detach(entity);
+
+				for (EntityID child = node.firstChild; child != NoEntity;)
+				{
+					EntityID next = nodes[child].nextSibling;
+					nodes[child].parent = NoEntity;
+					nodes[child].previousSibling = NoEntity;
+					nodes[child].nextSibling = NoEntity;
+					child = next;
+				}
+
+				node = Node();
+				Changed();
+			}
+
+			void Clear()
+			{
+				nodes.clear();
+				Changed();
+			}
+
+			EntityID GetParent(EntityID entity) const
+			{
+				return entity < nodes.size() ? nodes[entity].parent : NoEntity;
+			}
+
+			Children GetChildren(EntityID entity) const
+			{
+				if (entity >= nodes.size()) return Children(&nodes, NoEntity, 0);
+				return Children(&nodes, nodes[entity].firstChild, nodes[entity].childCount);
+			}
+
+			std::uint64_t GetVersion() const
+			{
+				return version;
+			}
+
+			// Walks the hierarchies breadth first. Roots are entities with children but no parent, in ID order.
+			void BuildOrder(HierarchyOrder& order) const
+			{
+				order.entities.clear();
+				order.parents.clear();
+				order.levels.clear();
+
+				for (EntityID entity = 0; entity < nodes.size(); entity++)
+				{
+					if (nodes[entity].parent == NoEntity && nodes[entity].firstChild != NoEntity)
+					{
+						order.entities.push_back(entity);
+						order.parents.push_back(NoEntity);
+					}
+				}
+
+				std::size_t levelBegin = 0;
+
+				while (levelBegin < order.entities.size())
+				{
+					std::size_t levelEnd = order.entities.size();
+					order.levels.push_back(levelBegin);
+
+					for (std::size_t index = levelBegin; index < levelEnd; index++)
+					{
+						for (EntityID child = nodes[order.entities[index]].firstChild; child != NoEntity; child = nodes[child].nextSibling)
+						{
+							order.entities.push_back(child);
+							order.parents.push_back(index);
+						}
+					}
+
+					levelBegin = levelEnd;
+				}
+
+				order.levels.push_back(order.entities.size());
+			}
+
+			// Copies the links for rollback, or returns the last copy while nothing changed since it was captured or
+			// restored. reuse is an older copy whose memory is reused when nothing else shares it.
+			std::shared_ptr<const State> Capture(std::shared_ptr<const State> reuse)
+			{
+				if (!modified && capture) return capture;
+
+				capture.reset();
+
+				std::shared_ptr<State> state = std::const_pointer_cast<State>(std::move(reuse));
+				if (!state || state.use_count() != 1) state = std::make_shared<State>();
+
+				state->nodes.assign(nodes.begin(), nodes.end());
+
+				capture = std::move(state);
+				modified = false;
+
+				return capture;
+			}
+
+			// Returns to links from Capture, a null state clears them.
+			void Restore(const std::shared_ptr<const State>& state)
+			{
+				if (state == capture && !modified) return;
+
+				if (state) nodes.assign(state->nodes.begin(), state->nodes.end());
+				else nodes.clear();
+
+				version++;
+				capture = state;
+				modified = !state;
+			}
+
+			std::size_t GetAllocatedBytes() const
+			{
+				return nodes.capacity() * sizeof(Node);
+			}
+		};
+
+		// Entities of a hierarchy with the queried components, ordered by depth so every parent comes before its
+		// children. Entities missing a component are left out, their children see no parent. Each depth can be
+		// split across threads, depths have to run one after another.
+		template <typename... Components>
+		class HierarchyView
+		{
+		private:
+			std::pmr::vector<EntityID> entities;
+			std::pmr::vector<std::size_t> parents; // Index of each entity's parent in the view, NoEntity if it has none.
+			std::pmr::vector<std::tuple<Components*...>> components;
+			std::pmr::vector<std::size_t> levels;
+
+			template <typename F, std::size_t... Indices>
+			void Invoke(std::size_t index, F& fn, std::index_sequence<Indices...>) const
+			{
+				static constexpr std::tuple<Components*...> noParent{};
+
+				const std::tuple<Components*...>& own = components[index];
+				const std::tuple<Components*...>& parent = parents[index] != NoEntity ? components[parents[index]] : noParent;
+
+				fn(entities[index], *std::get<Indices>(own)..., static_cast<const Components*>(std::get<Indices>(parent))...);
+			}
+
+		public:
+			explicit HierarchyView(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+				: entities(resource), parents(resource), components(resource), levels(1, 0, resource) {}
+
+			void Reserve(std::size_t count)
+			{
+				entities.reserve(count);
+				parents.reserve(count);
+				components.reserve(count);
+			}
+
+			// Appends an entity to the current depth, parent is its index in the view.
+			void Add(EntityID entity, std::size_t parent, const std::tuple<Components*...>& entityComponents)
+			{
+				entities.push_back(entity);
+				parents.push_back(parent);
+				components.push_back(entityComponents);
+			}
+
+			// Closes the current depth, the next entities added are one level deeper.
+			void EndLevel()
+			{
+				if (levels.back() != entities.size()) levels.push_back(entities.size());
+			}
+
+			std::size_t GetEntityCount() const
+			{
+				return entities.size();
+			}
+
+			std::size_t GetDepthCount() const
+			{
+				return levels.size() - 1;
+			}
+
+			std::size_t GetLevelBegin(std::size_t depth) const
+			{
+				return levels[depth];
+			}
+
+			std::size_t GetLevelEnd(std::size_t depth) const
+			{
+				return levels[depth + 1];
+			}
+
+			// Calls fn(entity, components..., parentComponents...) for the entities in [begin, end). The parent's
+			// components are const pointers, null when the entity has no parent in the view.
+			template <typename F>
+			void ForEach(std::size_t begin, std::size_t end, F&& fn) const
+			{
+				for (std::size_t index = begin; index < end; index++) Invoke(index, fn, std::index_sequence_for<Components...>());
+			}
+
+			template <typename F>
+			void ForEach(F&& fn) const
+			{
+				ForEach(0, entities.size(), fn);
+			}
+		};
+	}
+}
@@ -0,0 +1,188 @@
+#include "MemoryResource.h"
+#include "ThreadSlot.h"
+#include <algorithm>
+#include <stdexcept>
+#include <new>
+#include <cstdint>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace
+{
+	std::size_t RoundUp(std::size_t value, std::size_t multiple)
+	{
+		return (value + multiple - 1) / multiple * multiple;
+	}
+}
+
+Weave::ECS::FrameArena::ThreadArena& Weave::ECS::FrameArena::GetArena()
+{
+	std::size_t slot = Utilities::ThreadSlot::Current();
+	if (slot >= MaxThreads) throw std::runtime_error("Too many threads allocating from a FrameArena.");
+
+	ThreadArena* arena = arenas[slot].load(std::memory_order_acquire);
+	if (arena) return *arena;
+
+	std::lock_guard<std::mutex> lock(arenaCreationMutex);
+	ownedArenas.push_back(std::make_unique<ThreadArena>());
+	arena = ownedArenas.back().get();
+	arenas[slot].store(arena, std::memory_order_release);
+
+	return *arena;
+}
+
+void* Weave::ECS::FrameArena::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+	ThreadArena& arena = GetArena();
+
+	while (arena.currentBlock < arena.blocks.size())
+	{
+		Block& block = arena.blocks[arena.currentBlock];
+		std::uintptr_t address = reinterpret_cast<std::uintptr_t>(block.data) + arena.offset;
+		std::size_t aligned = arena.offset + (alignment - address % alignment) % alignment;
+
+		if (aligned + bytes <= block.size)
+		{
+			arena.offset = aligned + bytes;
+			return block.data + aligned;
+		}
+
+		arena.currentBlock++;
+		arena.offset = 0;
+	}
+
+	// Every block starts aligned, so a new block only has to be large enough.
+	Block block = { nullptr, std::max(blockSize, bytes), std::max(alignment, BlockAlignment) };
+	block.data = static_cast<std::byte*>(upstream->allocate(block.size, block.alignment));
+
+	arena.blocks.push_back(block);
+	arena.currentBlock = arena.blocks.size() - 1;
+	arena.offset = bytes;
+
+	return block.data;
+}
+
+Weave::ECS::FrameArena::~FrameArena()
+{
+	for (std::unique_ptr<ThreadArena>& arena : ownedArenas)
+	{
+		for (Block& block : arena->blocks) upstream->deallocate(block.data, block.size, block.alignment);
+	}
+}
+
+void Weave::ECS::FrameArena::Reset()
+{
+	std::lock_guard<std::mutex> lock(arenaCreationMutex);
+
+	for (std::unique_ptr<ThreadArena>& arena : ownedArenas)
+	{
+		arena->currentBlock = 0;
+		arena->offset = 0;
+	}
+}
+
+std::size_t Weave::ECS::FrameArena::GetCapacity() const
+{
+	std::size_t capacity = 0;
+
+	for (const std::unique_ptr<ThreadArena>& arena : ownedArenas)
+	{
+		for (const Block& block : arena->blocks) capacity += block.size;
+	}
+
+	return capacity;
+}
+
+Weave::ECS::ChunkPool::ChunkPool(std::size_t chunkSize, std::size_t chunkAlignment, std::size_t chunksPerSlab, std::pmr::memory_resource* upstream)
+	: upstream(upstream), chunkAlignment(std::max(chunkAlignment, alignof(FreeChunk))), chunksPerSlab(std::max<std::size_t>(chunksPerSlab, 1))
+{
+	// Every chunk of a slab has to stay aligned and hold a free list link.
+	this->chunkSize = RoundUp(std::max(chunkSize, sizeof(FreeChunk)), this->chunkAlignment);
+}
+
+Weave::ECS::ChunkPool::~ChunkPool()
+{
+	for (std::byte* slab : slabs) upstream->deallocate(slab, chunkSize * chunksPerSlab, chunkAlignment);
+}
+
+void* Weave::ECS::ChunkPool::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+	if (!Fits(bytes, alignment)) return upstream->allocate(bytes, alignment);
+
+	if (!freeChunks)
+	{
+		std::byte* slab = static_cast<std::byte*>(upstream->allocate(chunkSize * chunksPerSlab, chunkAlignment));
+		slabs.push_back(slab);
+
+		for (std::size_t chunk = chunksPerSlab; chunk-- > 0;)
+		{
+			freeChunks = new (slab + chunk * chunkSize) FreeChunk{ freeChunks };
+		}
+	}
+
+	FreeChunk* chunk = freeChunks;
+	freeChunks = chunk->next;
+
+	return chunk;
+}
+
+void Weave::ECS::ChunkPool::do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment)
+{
+	if (!Fits(bytes, alignment))
+	{
+		upstream->deallocate(pointer, bytes, alignment);
+		return;
+	}
+
+	freeChunks = new (pointer) FreeChunk{ freeChunks };
+}
+
+void* Weave::ECS::HugePageResource::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+#if defined(__linux__)
+	if (bytes >= threshold && alignment <= HugePageSize)
+	{
+		// Maps one huge page more than needed and trims both ends, leaving a range aligned to a huge page.
+		std::size_t size = RoundUp(bytes, HugePageSize);
+		std::size_t mappedSize = size + HugePageSize;
+
+		void* region = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (region == MAP_FAILED) throw std::bad_alloc();
+
+		std::uintptr_t start = reinterpret_cast<std::uintptr_t>(region);
+		std::uintptr_t aligned = RoundUp(start, HugePageSize);
+		std::uintptr_t end = start + mappedSize;
+
+		if (aligned > start) munmap(region, aligned - start);
+		if (end > aligned + size) munmap(reinterpret_cast<void*>(aligned + size), end - (aligned + size));
+
+#if defined(MADV_HUGEPAGE)
+		// Only advice, without transparent huge pages the range still works with regular pages.
+		madvise(reinterpret_cast<void*>(aligned), size, MADV_HUGEPAGE);
+#endif
+
+		mappedBytes.fetch_add(size, std::memory_order_relaxed);
+		return reinterpret_cast<void*>(aligned);
+	}
+#endif
+
+	return upstream->allocate(bytes, alignment);
+}
+
+void Weave::ECS::HugePageResource::do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment)
+{
+#if defined(__linux__)
+	if (bytes >= threshold && alignment <= HugePageSize)
+	{
+		std::size_t size = RoundUp(bytes, HugePageSize);
+
+		munmap(pointer, size);
+		mappedBytes.fetch_sub(size, std::memory_order_relaxed);
+		return;
+	}
+#endif
+
+	upstream->deallocate(pointer, bytes, alignment);
+}
@@ -0,0 +1,150 @@
+#pragma once
+#include <memory_resource>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <cstddef>
+
+namespace Weave
+{
+	namespace ECS
+	{
+		// Bump allocator for memory that lives until the next Reset, such as the scratch of views built during a frame.
+		// Every thread allocates from blocks of its own, so systems running on the thread pool don't contend.
+		// Deallocating does nothing, Reset reuses every block at once and must not run while anything allocates.
+		class FrameArena : public std::pmr::memory_resource
+		{
+		private:
+			struct Block
+			{
+				std::byte* data;
+				std::size_t size;
+				std::size_t alignment;
+			};
+
+			struct ThreadArena
+			{
+				std::vector<Block> blocks;
+				std::size_t currentBlock = 0;
+				std::size_t offset = 0;
+			};
+
+			static constexpr std::size_t MaxThreads = 1024;
+			static constexpr std::size_t BlockAlignment = 64;
+
+			std::pmr::memory_resource* upstream;
+			std::size_t blockSize;
+
+			std::unique_ptr<std::atomic<ThreadArena*>[]> arenas = std::make_unique<std::atomic<ThreadArena*>[]>(MaxThreads);
+			std::mutex arenaCreationMutex;
+			std::vector<std::unique_ptr<ThreadArena>> ownedArenas;
+
+			ThreadArena& GetArena();
+
+		protected:
+			void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+			void do_deallocate(void*, std::size_t, std::size_t) override {}
+
+			bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+			{
+				return this == &other;
+			}
+
+		public:
+			explicit FrameArena(std::size_t blockSize = 64 * 1024, std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+				: upstream(upstream), blockSize(blockSize) {}
+
+			FrameArena(const FrameArena&) = delete;
+			FrameArena& operator=(const FrameArena&) = delete;
+
+			~FrameArena() override;
+
+			void Reset();
+
+			// Bytes of blocks taken from upstream, over every thread.
+			std::size_t GetCapacity() const;
+		};
+
+		// Hands out chunks of one size from slabs, for storage that allocates many blocks of the same size such as
+		// sparse set pages (see SparseSetMemoryStats::SparsePageBytes). Freed chunks are kept for the next allocation,
+		// slabs go back upstream with the pool. Other sizes are passed upstream. Not thread safe, so it suits a World's
+		// storage, which only structural changes allocate, but not its view resource.
+		class ChunkPool : public std::pmr::memory_resource
+		{
+		private:
+			struct FreeChunk
+			{
+				FreeChunk* next;
+			};
+
+			std::pmr::memory_resource* upstream;
+			std::size_t chunkSize;
+			std::size_t chunkAlignment;
+			std::size_t chunksPerSlab;
+
+			std::vector<std::byte*> slabs;
+			FreeChunk* freeChunks = nullptr;
+
+			bool Fits(std::size_t bytes, std::size_t alignment) const
+			{
+				return bytes <= chunkSize && alignment <= chunkAlignment;
+			}
+
+		protected:
+			void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+			void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override;
+
+			bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+			{
+				return this == &other;
+			}
+
+		public:
+			ChunkPool(std::size_t chunkSize, std::size_t chunkAlignment = alignof(std::max_align_t), std::size_t chunksPerSlab = 64,
+				std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+
+			ChunkPool(const ChunkPool&) = delete;
+			ChunkPool& operator=(const ChunkPool&) = delete;
+
+			~ChunkPool() override;
+
+			std::size_t GetSlabCount() const
+			{
+				return slabs.size();
+			}
+		};
+
+		// Maps allocations of at least threshold bytes directly, aligned to 2 MiB and marked with MADV_HUGEPAGE so
+		// the kernel backs them with transparent huge pages. Large columns then take far fewer TLB entries to iterate.
+		// Smaller allocations, and every allocation on platforms without madvise, are passed upstream. Thread safe.
+		class HugePageResource : public std::pmr::memory_resource
+		{
+		private:
+			std::pmr::memory_resource* upstream;
+			std::size_t threshold;
+			std::atomic<std::size_t> mappedBytes = 0;
+
+		protected:
+			void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+			void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override;
+
+			bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+			{
+				return this == &other;
+			}
+
+		public:
+			explicit HugePageResource(std::size_t threshold = HugePageSize, std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+				: upstream(upstream), threshold(threshold) {}
+
+			// Bytes currently mapped for allocations over the threshold.
+			std::size_t GetMappedBytes() const
+			{
+				return mappedBytes.load(std::memory_order_relaxed);
+			}
+
+			static constexpr std::size_t HugePageSize = 2 * 1024 * 1024;
+		};
+	}
+}
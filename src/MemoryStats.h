@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+#include <typeindex>
+#include <cstddef>
+#include "SparseSet/SparseSet.h"
+
+namespace Weave
+{
+	namespace ECS
+	{
+		struct ColumnMemoryStats
+		{
+			std::type_index type;
+			std::size_t bytesAllocated;
+			std::size_t bytesUsed;
+		};
+
+		// Byte counts include the archetype's entity array.
+		struct ArchetypeMemoryStats
+		{
+			std::vector<ColumnMemoryStats> columns;
+			std::size_t entityCount = 0;
+			std::size_t bytesAllocated = 0;
+			std::size_t bytesUsed = 0;
+		};
+
+		// Entity ID allocation and, for the Archetype backend, the entity to row records.
+		struct EntityMemoryStats
+		{
+			std::size_t aliveEntities = 0;
+			std::size_t freeIDs = 0;
+			std::size_t bytesAllocated = 0;
+		};
+
+		// Where a World's memory goes. Used bytes only count live components and their indices, so the gap to
+		// allocated bytes is spare capacity. Entity bookkeeping is counted as allocated, never as used.
+		struct WorldMemoryStats
+		{
+			std::vector<ArchetypeMemoryStats> archetypes; // Empty for the SparseSet backend.
+			std::size_t emptyArchetypes = 0;
+
+			std::vector<SparseSetMemoryStats> sparseSets;
+			EntityMemoryStats entities;
+
+			std::size_t bytesAllocated = 0;
+			std::size_t bytesUsed = 0;
+
+			double GetUtilization() const
+			{
+				return bytesAllocated > 0 ? static_cast<double>(bytesUsed) / static_cast<double>(bytesAllocated) : 0.0;
+			}
+		};
+	}
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include <vector>
+#include <tuple>
+#include <limits>
+#include <cstdint>
+#include <cstddef>
+#include "World.h"
+
+namespace Weave
+{
+	namespace ECS
+	{
+		// Copy of one component type's values taken when the world was published.
+		template <typename T>
+		struct PublishedBuffer
+		{
+			static constexpr std::uint32_t Missing = std::numeric_limits<std::uint32_t>::max();
+
+			std::vector<EntityID> entities;
+			std::vector<T> values;
+			std::vector<std::uint32_t> indexes; // Position of each entity in entities, Missing when it had no value.
+
+			const T* Find(EntityID entity) const
+			{
+				if (entity >= indexes.size() || indexes[entity] == Missing) return nullptr;
+				return &values[indexes[entity]];
+			}
+		};
+
+		class IPublishedComponents
+		{
+		public:
+			virtual ~IPublishedComponents() = default;
+
+			// Copies the world's values into the back buffer, safe while the front buffer is read.
+			virtual void Capture(World& world) = 0;
+			virtual void Swap() = 0;
+		};
+
+		// Double-buffered copy of a component type. Readers use the front buffer while the world keeps changing,
+		// Capture fills the back buffer and Swap publishes it.
+		template <typename T>
+		class PublishedComponents : public IPublishedComponents
+		{
+		private:
+			PublishedBuffer<T> buffers[2];
+			std::size_t front = 0;
+
+		public:
+			void Capture(World& world) override
+			{
+				PublishedBuffer<T>& back = buffers[1 - front];
+
+				// Only the entries of the previous capture are reset, the index array keeps its size.
+				for (EntityID entity : back.entities) back.indexes[entity] = PublishedBuffer<T>::Missing;
+
+				back.entities.clear();
+				back.values.clear();
+
+				world.GetView<T>().ForEach([&back](EntityID entity, T& value) {
+					if (entity >= back.indexes.size()) back.indexes.resize(entity + 1, PublishedBuffer<T>::Missing);
+
+					back.indexes[entity] = static_cast<std::uint32_t>(back.entities.size());
+					back.entities.push_back(entity);
+					back.values.push_back(value);
+					});
+			}
+
+			void Swap() override
+			{
+				front = 1 - front;
+			}
+
+			const PublishedBuffer<T>& GetFront() const
+			{
+				return buffers[front];
+			}
+		};
+
+		// Entities that had every component when the world was last published, with the published values.
+		template <typename... Components>
+		class PublishedView
+		{
+		private:
+			std::tuple<const PublishedBuffer<Components>*...> buffers;
+
+		public:
+			explicit PublishedView(const PublishedBuffer<Components>&... buffers)
+				: buffers(&buffers...) {}
+
+			// Calls fn(entity, const components&...), walking the component with the fewest entities.
+			template <typename F>
+			void ForEach(F&& fn) const
+			{
+				if constexpr (sizeof...(Components) == 1)
+				{
+					const auto* buffer = std::get<0>(buffers);
+					for (std::size_t index = 0; index < buffer->entities.size(); index++) fn(buffer->entities[index], buffer->values[index]);
+				}
+				else
+				{
+					const std::vector<EntityID>* baseEntities = nullptr;
+
+					([&] {
+						const std::vector<EntityID>& entities = std::get<const PublishedBuffer<Components>*>(buffers)->entities;
+						if (!baseEntities || entities.size() < baseEntities->size()) baseEntities = &entities;
+						}(), ...);
+
+					for (EntityID entity : *baseEntities)
+					{
+						std::tuple<const Components*...> values(std::get<const PublishedBuffer<Components>*>(buffers)->Find(entity)...);
+						if ((!std::get<const Components*>(values) || ...)) continue;
+
+						fn(entity, *std::get<const Components*>(values)...);
+					}
+				}
+			}
+
+			std::size_t GetEntityCount() const
+			{
+				std::size_t count = 0;
+				ForEach([&count](EntityID, const Components&...) { count++; });
+				return count;
+			}
+		};
+	}
+}
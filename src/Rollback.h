@@ -0,0 +1,46 @@
+#pragma once
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <cstdint>
+
+namespace Weave
+{
+	namespace ECS
+	{
+		// A snapshot in a World's rollback ring, see World::Snapshot.
+		struct RollbackSnapshot
+		{
+			std::uint64_t sequence = 0;
+		};
+
+		// Copies taken from one kind of storage for a rollback snapshot, sorted by the storage they came from.
+		template <typename Storage, typename Copy>
+		struct RollbackCopies
+		{
+			std::vector<std::pair<const Storage*, Copy>> entries;
+
+			void Add(const Storage* storage, Copy copy)
+			{
+				entries.emplace_back(storage, std::move(copy));
+			}
+
+			void Sort()
+			{
+				std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) { return std::less<const Storage*>()(a.first, b.first); });
+			}
+
+			Copy* Find(const Storage* storage)
+			{
+				return const_cast<Copy*>(std::as_const(*this).Find(storage));
+			}
+
+			const Copy* Find(const Storage* storage) const
+			{
+				auto it = std::lower_bound(entries.begin(), entries.end(), storage, [](const auto& entry, const Storage* key) { return std::less<const Storage*>()(entry.first, key); });
+				return it != entries.end() && it->first == storage ? &it->second : nullptr;
+			}
+		};
+	}
+}
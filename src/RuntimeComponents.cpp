@@ -0,0 +1,152 @@
+#include "RuntimeComponents.h"
+#include "ComponentRegistry.h"
+#include <array>
+#include <utility>
+#include <stdexcept>
+#include <cstring>
+
+namespace
+{
+	using Weave::ECS::RuntimeComponents;
+
+	// Every runtime type borrows the type_index of one of these, so the worlds key its storage like any other type.
+	template <std::size_t Slot>
+	struct RuntimeComponentSlot {};
+
+	// Size of the type in each slot, read by the functions of plain data types.
+	std::size_t slotSizes[RuntimeComponents::MaxRuntimeComponents];
+
+	template <std::size_t Slot>
+	void MoveBytes(void* destination, void* source)
+	{
+		std::memcpy(destination, source, slotSizes[Slot]);
+	}
+
+	template <std::size_t Slot>
+	void CopyBytes(void* destination, const void* source)
+	{
+		std::memcpy(destination, source, slotSizes[Slot]);
+	}
+
+	template <std::size_t Slot>
+	void ZeroBytes(void* destination)
+	{
+		std::memset(destination, 0, slotSizes[Slot]);
+	}
+
+	void DestroyNothing(void*) {}
+
+	void CopyUnsupported(void*, const void*)
+	{
+		throw std::logic_error("Component type is not copy constructible.");
+	}
+
+	std::unique_ptr<Weave::ISparseSet> CreateUnsupportedSparseSet(std::pmr::memory_resource*)
+	{
+		throw std::logic_error("Runtime components need the Archetype backend.");
+	}
+
+	struct RuntimeSlot
+	{
+		const std::type_info* type;
+		void (*move)(void* destination, void* source);
+		void (*copy)(void* destination, const void* source);
+		void (*zero)(void* destination);
+	};
+
+	template <std::size_t... Slots>
+	std::array<RuntimeSlot, sizeof...(Slots)> MakeSlots(std::index_sequence<Slots...>)
+	{
+		return { { { &typeid(RuntimeComponentSlot<Slots>), &MoveBytes<Slots>, &CopyBytes<Slots>, &ZeroBytes<Slots> }... } };
+	}
+
+	// Initialized on first use, so types can be defined by static initializers of other translation units.
+	const std::array<RuntimeSlot, RuntimeComponents::MaxRuntimeComponents>& GetSlots()
+	{
+		static const std::array<RuntimeSlot, RuntimeComponents::MaxRuntimeComponents> slots = MakeSlots(std::make_index_sequence<RuntimeComponents::MaxRuntimeComponents>());
+		return slots;
+	}
+}
+
+Weave::ECS::ComponentID Weave::ECS::RuntimeComponents::Add(const ComponentInfo& info)
+{
+	ComponentID id = static_cast<ComponentID>(infos.size());
+
+	infos.push_back(&info);
+	byType.emplace(info.type, id);
+
+	return id;
+}
+
+Weave::ECS::ComponentID Weave::ECS::RuntimeComponents::Define(const ComponentDescriptor& descriptor)
+{
+	if (descriptor.name.empty()) throw std::invalid_argument("Runtime components need a name.");
+	if (descriptor.size == 0) throw std::invalid_argument("Runtime components can't be empty.");
+
+	if (descriptor.alignment == 0 || (descriptor.alignment & (descriptor.alignment - 1)) != 0 || descriptor.size % descriptor.alignment != 0)
+		throw std::invalid_argument("Component alignment must be a power of two that divides the size.");
+
+	bool plainData = !descriptor.destroy && !descriptor.moveConstruct && !descriptor.copyConstruct;
+
+	if (!plainData && (!descriptor.destroy || !descriptor.moveConstruct))
+		throw std::invalid_argument("Components with lifecycle functions need moveConstruct and destroy.");
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (byName.contains(descriptor.name)) throw std::logic_error("A runtime component is already defined as " + descriptor.name + ".");
+	if (runtimeInfos.size() == MaxRuntimeComponents) throw std::runtime_error("Too many runtime components.");
+
+	std::size_t slot = runtimeInfos.size();
+	slotSizes[slot] = descriptor.size;
+
+	const RuntimeSlot& functions = GetSlots()[slot];
+
+	std::unique_ptr<ComponentInfo> info = std::make_unique<ComponentInfo>(ComponentInfo{
+		*functions.type,
+		descriptor.size,
+		descriptor.alignment,
+		plainData,
+		StorageType::Table,
+		plainData ? functions.move : descriptor.moveConstruct,
+		plainData ? functions.copy : (descriptor.copyConstruct ? descriptor.copyConstruct : &CopyUnsupported),
+		descriptor.construct ? descriptor.construct : functions.zero,
+		plainData ? &DestroyNothing : descriptor.destroy,
+		&CreateUnsupportedSparseSet
+	});
+
+	// Registered before the type is published, so a name taken by another saved type leaves nothing behind.
+	if (plainData) ComponentRegistry::Get().Register(*info, descriptor.name, descriptor.version);
+
+	runtimeInfos.push_back(std::move(info));
+	ComponentID id = Add(*runtimeInfos.back());
+	byName.emplace(descriptor.name, id);
+
+	return id;
+}
+
+Weave::ECS::ComponentID Weave::ECS::RuntimeComponents::GetID(const ComponentInfo& info)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto it = byType.find(info.type);
+	if (it != byType.end()) return it->second;
+
+	return Add(info);
+}
+
+const Weave::ECS::ComponentInfo& Weave::ECS::RuntimeComponents::GetInfo(ComponentID id) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (id >= infos.size()) throw std::out_of_range("Unknown component ID.");
+
+	return *infos[id];
+}
+
+Weave::ECS::ComponentID Weave::ECS::RuntimeComponents::Find(std::string_view name) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto it = byName.find(std::string(name));
+	return it != byName.end() ? it->second : NoComponent;
+}
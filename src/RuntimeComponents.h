@@ -0,0 +1,143 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <typeindex>
+#include <limits>
+#include <cstdint>
+#include <cstddef>
+#include "ComponentInfo.h"
+
+namespace Weave
+{
+	namespace ECS
+	{
+		using ComponentID = std::uint32_t;
+
+		constexpr ComponentID NoComponent = std::numeric_limits<ComponentID>::max();
+
+		// A component type defined at runtime, by a scripting layer or an editor. Types without lifecycle functions
+		// are plain data: zero initialized unless construct is given, moved and copied with memcpy. Other types
+		// must give moveConstruct and destroy, and can only be copied, as rollback snapshots do, with copyConstruct.
+		struct ComponentDescriptor
+		{
+			std::string name;
+			std::size_t size = 0;
+			std::size_t alignment = 1;
+			std::uint32_t version = 0; // Saved with snapshots, see ComponentRegistry.
+
+			void (*construct)(void* destination) = nullptr;
+			void (*destroy)(void* component) = nullptr;
+			void (*moveConstruct)(void* destination, void* source) = nullptr;
+			void (*copyConstruct)(void* destination, const void* source) = nullptr;
+		};
+
+		// Numbers component types, whether defined in C++ or at runtime, so code that only knows types at runtime can
+		// address them by ID, see World::AddDynamicComponent and World::GetDynamicView. Runtime types are stored
+		// in archetype tables like any other, plain data ones are also registered with the ComponentRegistry
+		// under their name so snapshots save them.
+		class RuntimeComponents
+		{
+		public:
+			static constexpr std::size_t MaxRuntimeComponents = 1024;
+
+		private:
+			mutable std::mutex mutex;
+			std::vector<const ComponentInfo*> infos;
+			std::unordered_map<std::type_index, ComponentID> byType;
+			std::unordered_map<std::string, ComponentID> byName;
+			std::vector<std::unique_ptr<ComponentInfo>> runtimeInfos;
+
+			ComponentID Add(const ComponentInfo& info);
+
+		public:
+			static RuntimeComponents& Get()
+			{
+				static RuntimeComponents components;
+				return components;
+			}
+
+			// Throws when the name is taken, the layout is invalid or MaxRuntimeComponents types were defined.
+			ComponentID Define(const ComponentDescriptor& descriptor);
+
+			// The ID of a type defined in C++, assigned on first use.
+			ComponentID GetID(const ComponentInfo& info);
+
+			template <typename T>
+			static ComponentID IDOf()
+			{
+				static const ComponentID id = Get().GetID(ComponentInfo::Of<T>());
+				return id;
+			}
+
+			// Throws for unknown IDs.
+			const ComponentInfo& GetInfo(ComponentID id) const;
+
+			// The runtime type defined under name, NoComponent when there is none.
+			ComponentID Find(std::string_view name) const;
+		};
+
+		// Rows of one archetype matched by a dynamic query. The component of row r for the i-th queried ID is at
+		// columns[i] + r * DynamicView::GetStrides()[i].
+		struct DynamicChunk
+		{
+			const EntityID* entities;
+			std::size_t count;
+			std::byte* const* columns;
+		};
+
+		// Raw columns of the entities that have every queried component, built by World::GetDynamicView. The
+		// pointers stay valid until the world's next structural change, like those of any view.
+		class DynamicView
+		{
+		private:
+			std::pmr::vector<std::size_t> strides;
+			std::pmr::vector<std::byte*> columns;
+			std::pmr::vector<DynamicChunk> chunks;
+			std::size_t entityCount = 0;
+
+		public:
+			DynamicView(std::span<const std::size_t> componentStrides, std::pmr::memory_resource* resource)
+				: strides(componentStrides.begin(), componentStrides.end(), resource), columns(resource), chunks(resource) {}
+
+			DynamicView(const DynamicView&) = delete;
+			DynamicView& operator=(const DynamicView&) = delete;
+
+			DynamicView(DynamicView&&) = default;
+			DynamicView& operator=(DynamicView&&) = delete;
+
+			// chunkColumns holds one column per queried ID, in query order.
+			void AddChunk(const EntityID* entities, std::size_t count, std::span<std::byte* const> chunkColumns)
+			{
+				std::byte* const* previous = columns.data();
+				columns.insert(columns.end(), chunkColumns.begin(), chunkColumns.end());
+				chunks.push_back({ entities, count, nullptr });
+				entityCount += count;
+
+				// Chunks point into columns, which may just have moved.
+				std::size_t first = columns.data() == previous ? chunks.size() - 1 : 0;
+				for (std::size_t chunk = first; chunk < chunks.size(); chunk++) chunks[chunk].columns = columns.data() + chunk * strides.size();
+			}
+
+			std::span<const DynamicChunk> GetChunks() const
+			{
+				return chunks;
+			}
+
+			std::span<const std::size_t> GetStrides() const
+			{
+				return strides;
+			}
+
+			std::size_t GetEntityCount() const
+			{
+				return entityCount;
+			}
+		};
+	}
+}
@@ -0,0 +1,311 @@
+#include "Snapshot.h"
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <new>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	static_assert(sizeof(Weave::ECS::EntityID) == sizeof(std::uint64_t), "Snapshots store entity IDs as 64 bit values.");
+
+	constexpr char Magic[8] = { 'W', 'E', 'A', 'V', 'E', 'S', 'N', 'P' };
+	constexpr std::uint32_t Version = 1;
+	constexpr std::uint32_t ByteOrderMark = 0x01020304;
+
+	constexpr std::uint32_t SparseTableFlag = 1;
+
+	struct FileHeader
+	{
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t byteOrder;
+		std::uint64_t typeCount;
+		std::uint64_t typesOffset;
+		std::uint64_t tableCount;
+		std::uint64_t tablesOffset;
+		std::uint64_t nextEntity;
+		std::uint64_t freeCount;
+		std::uint64_t freeOffset;
+	};
+
+	struct FileType
+	{
+		std::uint64_t stableID;
+		std::uint64_t layoutHash;
+		std::uint64_t size;
+		std::uint64_t alignment;
+	};
+
+	struct FileTable
+	{
+		std::uint32_t flags;
+		std::uint32_t columnCount;
+		std::uint64_t entityCount;
+		std::uint64_t entitiesOffset;
+		std::uint64_t columnsOffset; // FileColumn[columnCount]
+	};
+
+	struct FileColumn
+	{
+		std::uint64_t type; // Index into the type table.
+		std::uint64_t dataOffset;
+	};
+
+	class SnapshotWriter
+	{
+	private:
+		std::ofstream file;
+		std::uint64_t offset = 0;
+
+	public:
+		explicit SnapshotWriter(const std::string& path)
+			: file(path, std::ios::binary | std::ios::trunc)
+		{
+			if (!file) throw std::runtime_error("Could not open " + path + " for writing.");
+		}
+
+		std::uint64_t GetOffset() const
+		{
+			return offset;
+		}
+
+		void Write(const void* bytes, std::size_t count)
+		{
+			file.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(count));
+			offset += count;
+		}
+
+		void Align(std::size_t alignment)
+		{
+			static constexpr char zeros[Weave::ECS::SnapshotFile::BlobAlignment] = {};
+
+			std::size_t padding = (alignment - offset % alignment) % alignment;
+			Write(zeros, padding);
+		}
+
+		// Overwrites earlier bytes, used for descriptors whose offsets are only known once the blobs are written.
+		void Patch(std::uint64_t position, const void* bytes, std::size_t count)
+		{
+			file.seekp(static_cast<std::streamoff>(position));
+			file.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(count));
+			file.seekp(static_cast<std::streamoff>(offset));
+		}
+
+		void Finish()
+		{
+			file.flush();
+			if (!file) throw std::runtime_error("Writing the snapshot failed.");
+		}
+	};
+}
+
+const Weave::ECS::RegisteredComponent& Weave::ECS::GetSnapshotComponent(std::type_index type)
+{
+	const RegisteredComponent* registered = ComponentRegistry::Get().Find(type);
+	if (!registered) throw std::runtime_error(std::string("Component type ") + type.name() + " is not registered for snapshots.");
+
+	return *registered;
+}
+
+void Weave::ECS::WriteSnapshot(const std::string& path, EntityID nextEntity, std::span<const EntityID> freeIDs, std::span<const SnapshotTable> tables)
+{
+	// Every component type used by a table, in order of first use.
+	std::vector<const RegisteredComponent*> types;
+	std::vector<std::vector<std::uint64_t>> tableTypes(tables.size());
+
+	for (std::size_t table = 0; table < tables.size(); table++)
+	{
+		for (const ComponentInfo* info : tables[table].infos)
+		{
+			const RegisteredComponent* registered = &GetSnapshotComponent(info->type);
+
+			std::size_t index = 0;
+			while (index < types.size() && types[index] != registered) index++;
+			if (index == types.size()) types.push_back(registered);
+
+			tableTypes[table].push_back(index);
+		}
+	}
+
+	SnapshotWriter writer(path);
+
+	FileHeader header{};
+	std::memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = Version;
+	header.byteOrder = ByteOrderMark;
+	header.typeCount = types.size();
+	header.tableCount = tables.size();
+	header.nextEntity = nextEntity;
+	header.freeCount = freeIDs.size();
+	writer.Write(&header, sizeof(header));
+
+	header.typesOffset = writer.GetOffset();
+	for (const RegisteredComponent* type : types)
+	{
+		FileType fileType{ type->stableID, type->layoutHash, type->info->size, type->info->alignment };
+		writer.Write(&fileType, sizeof(fileType));
+	}
+
+	header.freeOffset = writer.GetOffset();
+	writer.Write(freeIDs.data(), freeIDs.size_bytes());
+
+	// Descriptors are written as placeholders and patched once the blob offsets are known.
+	header.tablesOffset = writer.GetOffset();
+	std::vector<FileTable> fileTables(tables.size());
+	writer.Write(fileTables.data(), fileTables.size() * sizeof(FileTable));
+
+	std::vector<std::vector<FileColumn>> fileColumns(tables.size());
+
+	for (std::size_t table = 0; table < tables.size(); table++)
+	{
+		fileTables[table].columnsOffset = writer.GetOffset();
+		fileColumns[table].resize(tables[table].infos.size());
+		writer.Write(fileColumns[table].data(), fileColumns[table].size() * sizeof(FileColumn));
+	}
+
+	for (std::size_t table = 0; table < tables.size(); table++)
+	{
+		const SnapshotTable& source = tables[table];
+		FileTable& fileTable = fileTables[table];
+
+		fileTable.flags = source.sparse ? SparseTableFlag : 0;
+		fileTable.columnCount = static_cast<std::uint32_t>(source.infos.size());
+		fileTable.entityCount = source.entities.size();
+
+		writer.Align(SnapshotFile::BlobAlignment);
+		fileTable.entitiesOffset = writer.GetOffset();
+		writer.Write(source.entities.data(), source.entities.size_bytes());
+
+		for (std::size_t column = 0; column < source.infos.size(); column++)
+		{
+			writer.Align(SnapshotFile::BlobAlignment);
+			fileColumns[table][column] = { tableTypes[table][column], writer.GetOffset() };
+			writer.Write(source.columns[column], source.entities.size() * source.infos[column]->size);
+		}
+
+		writer.Patch(fileTable.columnsOffset, fileColumns[table].data(), fileColumns[table].size() * sizeof(FileColumn));
+	}
+
+	writer.Patch(header.tablesOffset, fileTables.data(), fileTables.size() * sizeof(FileTable));
+	writer.Patch(0, &header, sizeof(header));
+	writer.Finish();
+}
+
+std::shared_ptr<Weave::ECS::SnapshotFile> Weave::ECS::SnapshotFile::Open(const std::string& path)
+{
+	std::shared_ptr<SnapshotFile> snapshot(new SnapshotFile());
+
+#if defined(_WIN32)
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file) throw std::runtime_error("Could not open snapshot " + path + ".");
+
+	snapshot->size = static_cast<std::size_t>(file.tellg());
+	snapshot->data = static_cast<std::byte*>(::operator new(snapshot->size > 0 ? snapshot->size : 1, std::align_val_t(BlobAlignment)));
+
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(snapshot->data), static_cast<std::streamsize>(snapshot->size));
+	if (!file) throw std::runtime_error("Could not read snapshot " + path + ".");
+#else
+	int descriptor = open(path.c_str(), O_RDONLY);
+	if (descriptor < 0) throw std::runtime_error("Could not open snapshot " + path + ".");
+
+	struct stat status;
+	if (fstat(descriptor, &status) != 0 || status.st_size <= 0)
+	{
+		close(descriptor);
+		throw std::runtime_error("Could not read snapshot " + path + ".");
+	}
+
+	// Private and writable, adopted columns are modified in place without touching the file.
+	void* mapping = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor, 0);
+	close(descriptor);
+
+	if (mapping == MAP_FAILED) throw std::runtime_error("Could not map snapshot " + path + ".");
+
+	snapshot->data = static_cast<std::byte*>(mapping);
+	snapshot->size = static_cast<std::size_t>(status.st_size);
+	snapshot->mapped = true;
+#endif
+
+	snapshot->Parse();
+	return snapshot;
+}
+
+Weave::ECS::SnapshotFile::~SnapshotFile()
+{
+	if (!data) return;
+
+#if defined(_WIN32)
+	::operator delete(data, std::align_val_t(BlobAlignment));
+#else
+	if (mapped) munmap(data, size);
+#endif
+}
+
+void Weave::ECS::SnapshotFile::Parse()
+{
+	auto at = [this](std::uint64_t offset, std::uint64_t count, std::size_t elementSize, std::size_t alignment = alignof(std::uint64_t)) -> std::byte*
+		{
+			if (offset > size || offset % alignment != 0 || (elementSize > 0 && count > (size - offset) / elementSize))
+				throw std::runtime_error("Snapshot is truncated or corrupt.");
+
+			return data + offset;
+		};
+
+	FileHeader header;
+	std::memcpy(&header, at(0, 1, sizeof(FileHeader)), sizeof(header));
+
+	if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0) throw std::runtime_error("File is not a Weave snapshot.");
+	if (header.byteOrder != ByteOrderMark) throw std::runtime_error("Snapshot was written on a platform with another byte order.");
+	if (header.version != Version) throw std::runtime_error("Snapshot version " + std::to_string(header.version) + " is not supported.");
+
+	ComponentRegistry& registry = ComponentRegistry::Get();
+
+	const FileType* fileTypes = reinterpret_cast<const FileType*>(at(header.typesOffset, header.typeCount, sizeof(FileType)));
+	std::vector<const ComponentInfo*> infos(header.typeCount);
+
+	for (std::uint64_t type = 0; type < header.typeCount; type++)
+	{
+		const RegisteredComponent* registered = registry.Find(fileTypes[type].stableID);
+		if (!registered) throw std::runtime_error("Snapshot contains a component type that is not registered.");
+
+		if (registered->layoutHash != fileTypes[type].layoutHash || registered->info->size != fileTypes[type].size)
+			throw std::runtime_error("Layout of component " + registered->name + " changed since the snapshot was saved.");
+
+		infos[type] = registered->info;
+	}
+
+	nextEntity = header.nextEntity;
+	freeIDs = std::span<const EntityID>(reinterpret_cast<const EntityID*>(at(header.freeOffset, header.freeCount, sizeof(EntityID))), header.freeCount);
+
+	const FileTable* fileTables = reinterpret_cast<const FileTable*>(at(header.tablesOffset, header.tableCount, sizeof(FileTable)));
+	tables.resize(header.tableCount);
+
+	for (std::uint64_t table = 0; table < header.tableCount; table++)
+	{
+		const FileTable& fileTable = fileTables[table];
+		SnapshotTable& snapshotTable = tables[table];
+
+		snapshotTable.sparse = (fileTable.flags & SparseTableFlag) != 0;
+		snapshotTable.entities = std::span<const EntityID>(reinterpret_cast<const EntityID*>(at(fileTable.entitiesOffset, fileTable.entityCount, sizeof(EntityID), BlobAlignment)), fileTable.entityCount);
+
+		const FileColumn* fileColumns = reinterpret_cast<const FileColumn*>(at(fileTable.columnsOffset, fileTable.columnCount, sizeof(FileColumn)));
+
+		for (std::uint32_t column = 0; column < fileTable.columnCount; column++)
+		{
+			if (fileColumns[column].type >= infos.size()) throw std::runtime_error("Snapshot is truncated or corrupt.");
+
+			const ComponentInfo* info = infos[fileColumns[column].type];
+			snapshotTable.infos.push_back(info);
+			snapshotTable.columns.push_back(at(fileColumns[column].dataOffset, fileTable.entityCount, info->size, BlobAlignment));
+		}
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <memory>
+#include <span>
+#include <cstdint>
+#include <cstddef>
+#include "ComponentInfo.h"
+#include "ComponentRegistry.h"
+
+namespace Weave
+{
+	namespace ECS
+	{
+		enum class SnapshotLoadMode
+		{
+			Copy,  // Copies every column into storage owned by the World.
+			Adopt  // Table columns point into the mapped file until they grow, the file stays mapped while they do.
+		};
+
+		// Entities and their components stored together in a snapshot. An archetype is one table holding all of its
+		// columns, a sparse set is a sparse table with a single column.
+		struct SnapshotTable
+		{
+			bool sparse = false;
+			std::span<const EntityID> entities;
+			std::vector<const ComponentInfo*> infos;
+			std::vector<const void*> columns; // entities.size() components per info.
+		};
+
+		// Registry entry of a component type that is saved, throws when it isn't registered.
+		const RegisteredComponent& GetSnapshotComponent(std::type_index type);
+
+		// Writes a versioned snapshot: the entity allocator state followed by every table, each column as one
+		// aligned blob. Throws when a component type isn't registered with the ComponentRegistry.
+		void WriteSnapshot(const std::string& path, EntityID nextEntity, std::span<const EntityID> freeIDs, std::span<const SnapshotTable> tables);
+
+		// A snapshot mapped into memory and checked against the ComponentRegistry. Column data may be written to,
+		// the mapping is private so changes never reach the file. Without mmap the file is read into memory instead.
+		class SnapshotFile
+		{
+		private:
+			std::byte* data = nullptr;
+			std::size_t size = 0;
+			bool mapped = false;
+
+			EntityID nextEntity = 0;
+			std::span<const EntityID> freeIDs;
+			std::vector<SnapshotTable> tables;
+
+			SnapshotFile() = default;
+			void Parse();
+
+		public:
+			static std::shared_ptr<SnapshotFile> Open(const std::string& path);
+
+			SnapshotFile(const SnapshotFile&) = delete;
+			SnapshotFile& operator=(const SnapshotFile&) = delete;
+			~SnapshotFile();
+
+			EntityID GetNextEntity() const
+			{
+				return nextEntity;
+			}
+
+			std::span<const EntityID> GetFreeIDs() const
+			{
+				return freeIDs;
+			}
+
+			const std::vector<SnapshotTable>& GetTables() const
+			{
+				return tables;
+			}
+
+			// Column blobs are aligned to this, columns of more strictly aligned types are always copied.
+			static constexpr std::size_t BlobAlignment = 64;
+		};
+	}
+}
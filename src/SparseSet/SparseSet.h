@@ -2,29 +2,118 @@
 #include <cstdint>
 #include <vector>
 #include <memory>
+#include <memory_resource>
 #include <array>
 #include <algorithm>
 #include <span>
+#include <utility>
+#include <typeindex>
+#include <atomic>
+#include <type_traits>
+#include <stdexcept>
 
 namespace Weave
 {
+	struct SparseSetMemoryStats
+	{
+		std::type_index type;
+		std::size_t sparsePages;     // Pages allocated for the sparse index.
+		std::size_t sparsePageSlots; // Entries in the page table, allocated or not.
+		std::size_t denseCount;
+		std::size_t denseCapacity;
+		std::size_t bytesAllocated;
+		std::size_t bytesUsed;
+
+		// Share of the allocated sparse entries that point at a component.
+		double GetOccupancy() const
+		{
+			return sparsePages > 0 ? static_cast<double>(denseCount) / static_cast<double>(sparsePages * SparsePageSize) : 0.0;
+		}
+
+		static constexpr std::size_t SparsePageSize = 1024;
+		static constexpr std::size_t SparsePageBytes = SparsePageSize * sizeof(std::size_t);
+	};
+
+	// Contents of a sparse set kept for rollback, shared between snapshots while the set doesn't change. The
+	// indexes are shared on their own, as long as no component is added or removed.
+	class SparseSetCopy
+	{
+	public:
+		std::shared_ptr<const std::vector<std::size_t>> denseToSparse;
+
+		virtual ~SparseSetCopy() = default;
+
+		virtual std::type_index GetType() const = 0;
+		virtual const void* GetDenseData() const = 0;
+	};
+
+	template <typename T>
+	struct TypedSparseSetCopy : public SparseSetCopy
+	{
+		std::vector<T> dense;
+
+		std::type_index GetType() const override
+		{
+			return typeid(T);
+		}
+
+		const void* GetDenseData() const override
+		{
+			return dense.data();
+		}
+	};
+
 	class ISparseSet
 	{
 	public:
+		virtual ~ISparseSet() = default;
+
 		virtual std::size_t Size() = 0;
 		virtual bool HasIndex(std::size_t index) = 0;
 		virtual void Delete(std::size_t index) = 0;
+
+		// The component at index, null when there is none.
+		virtual void* TryGet(std::size_t index) = 0;
+
+		// Sets the component at index by moving from data, which must point at a T.
+		virtual void Emplace(std::size_t index, void* data) = 0;
+
+		// Emplaces one component per index from data, an array of T with as many elements.
+		virtual void EmplaceRange(std::span<const std::size_t> indexes, void* data) = 0;
+
+		virtual SparseSetMemoryStats GetMemoryStats() const = 0;
+
+		// The packed components and the index each of them belongs to, in the same order.
+		virtual const void* GetDenseData() const = 0;
+		virtual std::span<const std::size_t> GetDenseIndexes() const = 0;
+
+		// Copies the set for rollback, or returns the last copy while the set is unchanged since it was captured
+		// or restored. reuse is an older copy whose memory is reused when nothing else shares it.
+		virtual std::shared_ptr<const SparseSetCopy> Capture(std::shared_ptr<const SparseSetCopy> reuse) = 0;
+
+		// Replaces the contents with a copy from Capture, a null copy empties the set.
+		virtual void Restore(const std::shared_ptr<const SparseSetCopy>& copy) = 0;
 	};
 
+	// Pages, components and indexes are allocated from the given memory resource, every page is
+	// SparseSetMemoryStats::SparsePageBytes large.
 	template<typename T>
 	struct SparseSet : public ISparseSet
 	{
 	private:
-		static constexpr std::size_t SPARSE_PAGE_SIZE = 1024;
+		static constexpr std::size_t SPARSE_PAGE_SIZE = SparseSetMemoryStats::SparsePageSize;
 
-		std::vector<std::unique_ptr<std::array<std::size_t, SPARSE_PAGE_SIZE>>> sparsePages;
-		std::vector<T> dense;
-		std::vector<std::size_t> denseToSparse;
+		using SparsePage = std::array<std::size_t, SPARSE_PAGE_SIZE>;
+
+		std::pmr::vector<SparsePage*> sparsePages;
+		std::pmr::vector<T> dense;
+		std::pmr::vector<std::size_t> denseToSparse;
+
+		// Set whenever the components may have been written, cleared by Capture and Restore. Adding or removing
+		// components also sets indexesModified.
+		std::atomic<bool> modified = true;
+		bool indexesModified = true;
+		std::shared_ptr<const SparseSetCopy> capture;
 
 		struct PaginatedArrayIndex
 		{
@@ -53,10 +142,10 @@ namespace Weave
 			if (sparseIndex.page >= sparsePages.size())
 				return SIZE_MAX;
 
-			if (!sparsePages[sparseIndex.page].get())
+			if (!sparsePages[sparseIndex.page])
 				return SIZE_MAX;
 
-			return (*sparsePages[sparseIndex.page].get())[sparseIndex.index];
+			return (*sparsePages[sparseIndex.page])[sparseIndex.index];
 		}
 
 		std::size_t* GetDenseIndexPtr(std::size_t index)
@@ -66,14 +155,14 @@ namespace Weave
 			if (sparseIndex.page >= sparsePages.size())
 				return nullptr;
 
-			if (!sparsePages[sparseIndex.page].get())
+			if (!sparsePages[sparseIndex.page])
 				return nullptr;
 
-			return &(*sparsePages[sparseIndex.page].get())[sparseIndex.index];
+			return &(*sparsePages[sparseIndex.page])[sparseIndex.index];
 		}
 
-	public:
-		void Set(std::size_t index, T data)
+		// Allocates the page of index if needed.
+		std::size_t& GetSparseEntry(std::size_t index)
 		{
 			PaginatedArrayIndex sparseIndex = GetSparseIndex(index);
 
@@ -82,27 +171,65 @@ namespace Weave
 				sparsePages.resize(sparseIndex.page + 1);
 			}
 
-			if (!sparsePages[sparseIndex.page].get())
+			if (!sparsePages[sparseIndex.page])
 			{
-				sparsePages[sparseIndex.page] = std::make_unique<std::array<std::size_t, SPARSE_PAGE_SIZE>>();
-				sparsePages[sparseIndex.page].get()->fill(SIZE_MAX);
+				sparsePages[sparseIndex.page] = static_cast<SparsePage*>(sparsePages.get_allocator().resource()->allocate(sizeof(SparsePage), alignof(SparsePage)));
+				sparsePages[sparseIndex.page]->fill(SIZE_MAX);
 			}
 
-			std::size_t currentDenseIndex = (*sparsePages[sparseIndex.page].get())[sparseIndex.index];
+			return (*sparsePages[sparseIndex.page])[sparseIndex.index];
+		}
+
+	public:
+		explicit SparseSet(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: sparsePages(resource), dense(resource), denseToSparse(resource) {}
+
+		SparseSet(const SparseSet&) = delete;
+		SparseSet& operator=(const SparseSet&) = delete;
+
+		~SparseSet() override
+		{
+			for (SparsePage* page : sparsePages)
+			{
+				if (page) sparsePages.get_allocator().resource()->deallocate(page, sizeof(SparsePage), alignof(SparsePage));
+			}
+		}
+
+		void Set(std::size_t index, T data)
+		{
+			modified.store(true, std::memory_order_relaxed);
+
+			std::size_t& currentDenseIndex = GetSparseEntry(index);
 
 			if (currentDenseIndex == SIZE_MAX)
 			{
-				(*sparsePages[sparseIndex.page].get())[sparseIndex.index] = dense.size();
+				indexesModified = true;
+				currentDenseIndex = dense.size();
 				denseToSparse.push_back(index);
-				dense.push_back(data);
+				dense.push_back(std::move(data));
 			}
 			else
 			{
-				dense[currentDenseIndex] = data;
+				dense[currentDenseIndex] = std::move(data);
 				denseToSparse[currentDenseIndex] = index;
 			}
 		}
 
+		void Emplace(std::size_t index, void* data) override
+		{
+			Set(index, std::move(*static_cast<T*>(data)));
+		}
+
+		void EmplaceRange(std::span<const std::size_t> indexes, void* data) override
+		{
+			T* values = static_cast<T*>(data);
+
+			dense.reserve(dense.size() + indexes.size());
+			denseToSparse.reserve(denseToSparse.size() + indexes.size());
+
+			for (std::size_t i = 0; i < indexes.size(); i++) Set(indexes[i], std::move(values[i]));
+		}
+
 		void Delete(std::size_t index) override
 		{
 			std::size_t denseIndex = GetDenseIndex(index);
@@ -110,6 +237,9 @@ namespace Weave
 			if (denseIndex == SIZE_MAX)
 				return;
 
+			modified.store(true, std::memory_order_relaxed);
+			indexesModified = true;
+
 			*GetDenseIndexPtr(denseToSparse.back()) = denseIndex;
 			*GetDenseIndexPtr(index) = SIZE_MAX;
 
@@ -127,9 +257,15 @@ namespace Weave
 			if (denseIndex == SIZE_MAX)
 				return nullptr;
 
+			modified.store(true, std::memory_order_relaxed);
 			return &dense[denseIndex];
 		}
 
+		void* TryGet(std::size_t index) override
+		{
+			return Get(index);
+		}
+
 		bool HasIndex(std::size_t index) override
 		{
 			std::size_t denseIndex = GetDenseIndex(index);
@@ -142,10 +278,21 @@ namespace Weave
 
 		std::span<T> GetDenseView()
 		{
+			modified.store(true, std::memory_order_relaxed);
 			return std::span<T>(dense);
 		}
 
 		std::vector<std::size_t> GetIndexes()
+		{
+			return std::vector<std::size_t>(denseToSparse.begin(), denseToSparse.end());
+		}
+
+		const void* GetDenseData() const override
+		{
+			return dense.data();
+		}
+
+		std::span<const std::size_t> GetDenseIndexes() const override
 		{
 			return denseToSparse;
 		}
@@ -154,5 +301,85 @@ namespace Weave
 		{
 			return dense.size();
 		}
+
+		std::shared_ptr<const SparseSetCopy> Capture(std::shared_ptr<const SparseSetCopy> reuse) override
+		{
+			if (!modified.load(std::memory_order_relaxed) && capture) return capture;
+
+			if constexpr (!std::is_copy_constructible_v<T>)
+			{
+				throw std::logic_error("Component type is not copy constructible.");
+			}
+			else
+			{
+				std::shared_ptr<const std::vector<std::size_t>> indexes = capture && !indexesModified ? capture->denseToSparse : nullptr;
+				capture.reset();
+
+				std::shared_ptr<TypedSparseSetCopy<T>> copy = std::static_pointer_cast<TypedSparseSetCopy<T>>(std::const_pointer_cast<SparseSetCopy>(std::move(reuse)));
+				if (!copy || copy.use_count() != 1) copy = std::make_shared<TypedSparseSetCopy<T>>();
+
+				if (!indexes)
+				{
+					std::shared_ptr<std::vector<std::size_t>> indexCopy = std::const_pointer_cast<std::vector<std::size_t>>(std::move(copy->denseToSparse));
+					if (!indexCopy || indexCopy.use_count() != 1) indexCopy = std::make_shared<std::vector<std::size_t>>();
+
+					indexCopy->assign(denseToSparse.begin(), denseToSparse.end());
+					indexes = std::move(indexCopy);
+				}
+
+				copy->dense.assign(dense.begin(), dense.end());
+				copy->denseToSparse = std::move(indexes);
+
+				capture = std::move(copy);
+				modified.store(false, std::memory_order_relaxed);
+				indexesModified = false;
+
+				return capture;
+			}
+		}
+
+		void Restore(const std::shared_ptr<const SparseSetCopy>& copy) override
+		{
+			if (copy == capture && !modified.load(std::memory_order_relaxed)) return;
+
+			// The sparse index only has to be rebuilt when components were added or removed.
+			bool sameIndexes = copy && capture && !indexesModified && copy->denseToSparse == capture->denseToSparse;
+
+			if (!sameIndexes)
+			{
+				for (std::size_t index : denseToSparse) *GetDenseIndexPtr(index) = SIZE_MAX;
+
+				denseToSparse.clear();
+				if (copy) denseToSparse.assign(copy->denseToSparse->begin(), copy->denseToSparse->end());
+
+				for (std::size_t denseIndex = 0; denseIndex < denseToSparse.size(); denseIndex++) GetSparseEntry(denseToSparse[denseIndex]) = denseIndex;
+			}
+
+			if (copy)
+			{
+				const TypedSparseSetCopy<T>& typedCopy = static_cast<const TypedSparseSetCopy<T>&>(*copy);
+				dense.assign(typedCopy.dense.begin(), typedCopy.dense.end());
+			}
+			else
+			{
+				dense.clear();
+			}
+
+			capture = copy;
+			modified.store(!copy, std::memory_order_relaxed);
+			indexesModified = !copy;
+		}
+
+		SparseSetMemoryStats GetMemoryStats() const override
+		{
+			std::size_t pages = std::count_if(sparsePages.begin(), sparsePages.end(), [](const SparsePage* page) { return page != nullptr; });
+			std::size_t pageBytes = sizeof(SparsePage);
+
+			std::size_t allocated = sparsePages.capacity() * sizeof(sparsePages[0]) + pages * pageBytes
+				+ dense.capacity() * sizeof(T) + denseToSparse.capacity() * sizeof(std::size_t);
+			std::size_t used = dense.size() * (sizeof(T) + 2 * sizeof(std::size_t));
+
+			return { typeid(T), pages, sparsePages.size(), dense.size(), dense.capacity(), allocated, used };
+		}
 	};
 }
\ No newline at end of file
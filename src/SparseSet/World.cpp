@@ -1,31 +1,341 @@
 #pragma once
 #include "World.h"
 
+Weave::ECS::World::World(std::pmr::memory_resource* resource)
+	: memoryResource(resource), viewResource(std::pmr::get_default_resource()) { }
+
+void Weave::ECS::World::SetViewResource(std::pmr::memory_resource* resource)
+{
+	viewResource = resource;
+}
+
 Weave::ECS::EntityID Weave::ECS::World::CreateEntity()
 {
-	if (!availableEntityIDs.empty())
-		return availableEntityIDs.extract(availableEntityIDs.begin()).value();
+	FlushReservedEntities();
 
-	return nextEntityID++;
+	return entityAllocator.Allocate();
 }
 
 void Weave::ECS::World::DeleteEntity(EntityID entity)
 {
+	FlushReservedEntities();
+
 	if (!IsEntityRegistered(entity))
 		throw std::logic_error("Entity is not registered.");
 
 	for (std::pair<const std::type_index, std::unique_ptr<ISparseSet>>& pair : componentStorage)
 	{
+		if (observers.IsActive() && pair.second->HasIndex(entity)) observers.Record(pair.first, entity, true, false);
 		pair.second->Delete(entity);
 	}
 
-	availableEntityIDs.insert(entity);
+	hierarchy.Remove(entity);
+	entityAllocator.Free(entity);
 }
 
 bool Weave::ECS::World::IsEntityRegistered(Weave::ECS::EntityID entity) const
 {
-	if (entity > nextEntityID) return false;
-	if (availableEntityIDs.find(entity) != availableEntityIDs.end()) return false;
+	return entityAllocator.IsAlive(entity);
+}
+
+Weave::ECS::EntityID Weave::ECS::World::ReserveEntity()
+{
+	return entityAllocator.Reserve();
+}
+
+void Weave::ECS::World::FlushReservedEntities()
+{
+	if (entityAllocator.HasReserved()) entityAllocator.FlushReserved();
+}
+
+void Weave::ECS::World::SaveSnapshot(const std::string& path)
+{
+	FlushReservedEntities();
+
+	std::vector<SnapshotTable> tables;
+
+	for (const std::pair<const std::type_index, std::unique_ptr<ISparseSet>>& pair : componentStorage)
+	{
+		if (pair.second->GetDenseIndexes().empty()) continue;
+
+		SnapshotTable& table = tables.emplace_back();
+		table.sparse = true;
+		table.entities = pair.second->GetDenseIndexes();
+		table.infos.push_back(GetSnapshotComponent(pair.first).info);
+		table.columns.push_back(pair.second->GetDenseData());
+	}
+
+	WriteSnapshot(path, entityAllocator.GetCapacity(), entityAllocator.GetFreeIDs(), tables);
+}
+
+void Weave::ECS::World::LoadSnapshot(const std::string& path, SnapshotLoadMode mode)
+{
+	(void)mode;
+
+	std::shared_ptr<SnapshotFile> snapshot = SnapshotFile::Open(path);
+
+	FlushReservedEntities();
+	componentStorage.clear();
+	hierarchy.Clear();
+
+	// Snapshots point at the sets that were just cleared.
+	for (RollbackFrame& frame : rollbackFrames) frame = RollbackFrame();
+
+	entityAllocator.Restore(snapshot->GetNextEntity(), snapshot->GetFreeIDs());
+
+	for (const SnapshotTable& table : snapshot->GetTables())
+	{
+		for (EntityID entity : table.entities)
+		{
+			if (!entityAllocator.IsAlive(entity)) throw std::runtime_error("Snapshot is truncated or corrupt.");
+		}
+
+		for (std::size_t column = 0; column < table.infos.size(); column++)
+		{
+			const ComponentInfo* info = table.infos[column];
+			std::byte* values = static_cast<std::byte*>(const_cast<void*>(table.columns[column]));
+
+			std::unique_ptr<ISparseSet>& set = componentStorage[info->type];
+			if (!set) set = info->createSparseSet(memoryResource);
+
+			set->EmplaceRange(table.entities, values);
+		}
+	}
+
+	observers.Discard();
+}
+
+Weave::ECS::RollbackSnapshot Weave::ECS::World::Snapshot()
+{
+	FlushReservedEntities();
+
+	RollbackFrame& frame = rollbackFrames[rollbackSequence % rollbackFrames.size()];
+
+	// The overwritten snapshot hands its copies to the new one, those no other snapshot shares are reused.
+	RollbackFrame previous = std::move(frame);
+	frame = RollbackFrame();
+
+	frame.entities = entityAllocator.Capture(std::move(previous.entities));
+	frame.hierarchy = hierarchy.Capture(std::move(previous.hierarchy));
+
+	for (const std::pair<const std::type_index, std::unique_ptr<ISparseSet>>& pair : componentStorage)
+	{
+		std::shared_ptr<const SparseSetCopy>* reuse = previous.sparseSets.Find(pair.second.get());
+		frame.sparseSets.Add(pair.second.get(), pair.second->Capture(reuse ? std::move(*reuse) : nullptr));
+	}
+
+	frame.sparseSets.Sort();
+	frame.sequence = ++rollbackSequence;
+
+	return { frame.sequence };
+}
+
+void Weave::ECS::World::Restore(RollbackSnapshot snapshot)
+{
+	RollbackFrame& frame = GetRollbackFrame(snapshot);
+
+	FlushReservedEntities();
+	entityAllocator.Restore(frame.entities);
+	hierarchy.Restore(frame.hierarchy);
+
+	for (const std::pair<const std::type_index, std::unique_ptr<ISparseSet>>& pair : componentStorage)
+	{
+		const std::shared_ptr<const SparseSetCopy>* copy = frame.sparseSets.Find(pair.second.get());
+		pair.second->Restore(copy ? *copy : nullptr);
+	}
+
+	observers.Discard();
+}
+
+std::vector<std::byte> Weave::ECS::World::ExtractDelta(RollbackSnapshot baseline, RollbackSnapshot target)
+{
+	const RollbackFrame* from = baseline.sequence != 0 ? &GetRollbackFrame(baseline) : nullptr;
+	const RollbackFrame& to = GetRollbackFrame(target);
+
+	DeltaWriter writer;
+	writer.AddEntityChanges(from ? from->entities.get() : nullptr, *to.entities);
+
+	for (const auto& [sparseSet, copy] : to.sparseSets.entries)
+	{
+		const std::shared_ptr<const SparseSetCopy>* baselineCopy = from ? from->sparseSets.Find(sparseSet) : nullptr;
+		writer.AddSparseSetChanges(baselineCopy ? baselineCopy->get() : nullptr, *copy, *to.entities);
+	}
+
+	return writer.Finish(baseline.sequence, target.sequence);
+}
+
+std::uint64_t Weave::ECS::World::ApplyDelta(std::span<const std::byte> delta)
+{
+	DeltaBatch batch(delta);
+
+	FlushReservedEntities();
+
+	for (EntityID entity : batch.GetSpawned()) entityAllocator.Claim(entity);
+
+	for (const EntityTransition& transition : batch.GetTransitions())
+	{
+		if (!IsEntityRegistered(transition.entity) || (transition.deleted && !transition.ops.empty()))
+			throw std::runtime_error("Delta does not match the world's entities.");
+	}
+
+	ApplyTransitions(batch.GetTransitions());
+
+	return batch.GetTarget();
+}
+
+Weave::ECS::World::RollbackFrame& Weave::ECS::World::GetRollbackFrame(RollbackSnapshot snapshot)
+{
+	RollbackFrame& frame = rollbackFrames[(snapshot.sequence - 1) % rollbackFrames.size()];
+
+	if (snapshot.sequence == 0 || frame.sequence != snapshot.sequence)
+		throw std::logic_error("Snapshot is no longer in the rollback ring.");
+
+	return frame;
+}
+
+void Weave::ECS::World::SetRollbackCapacity(std::size_t capacity)
+{
+	if (capacity == 0) throw std::invalid_argument("The rollback ring needs room for at least one snapshot.");
+
+	rollbackFrames.clear();
+	rollbackFrames.resize(capacity);
+}
+
+Weave::ECS::WorldMemoryStats Weave::ECS::World::GetMemoryStats() const
+{
+	WorldMemoryStats stats;
+	stats.sparseSets.reserve(componentStorage.size());
 
-	return true;
-}
\ No newline at end of file
+	for (const std::pair<const std::type_index, std::unique_ptr<ISparseSet>>& pair : componentStorage)
+	{
+		stats.sparseSets.push_back(pair.second->GetMemoryStats());
+		stats.bytesAllocated += stats.sparseSets.back().bytesAllocated;
+		stats.bytesUsed += stats.sparseSets.back().bytesUsed;
+	}
+
+	stats.entities.aliveEntities = entityAllocator.GetAliveCount();
+	stats.entities.freeIDs = entityAllocator.GetFreeCount();
+	stats.entities.bytesAllocated = entityAllocator.GetAllocatedBytes() + hierarchy.GetAllocatedBytes();
+	stats.bytesAllocated += stats.entities.bytesAllocated;
+
+	return stats;
+}
+
+void Weave::ECS::World::ApplyTransitions(std::span<const EntityTransition> transitions)
+{
+	// Consecutive transitions usually touch the same components, so the last set looked up is kept.
+	const ComponentInfo* lastInfo = nullptr;
+	ISparseSet* lastSet = nullptr;
+
+	for (const EntityTransition& transition : transitions)
+	{
+		if (transition.deleted)
+		{
+			DeleteEntity(transition.entity);
+			continue;
+		}
+
+		if (transition.ops.empty()) continue;
+
+		if (!IsEntityRegistered(transition.entity))
+			throw std::logic_error("Entity is not registered.");
+
+		for (const ComponentOp& op : transition.ops)
+		{
+			if (op.info != lastInfo)
+			{
+				std::unordered_map<std::type_index, std::unique_ptr<ISparseSet>>::iterator it = componentStorage.find(op.info->type);
+
+				if (it == componentStorage.end() && op.value) it = componentStorage.emplace(op.info->type, op.info->createSparseSet(memoryResource)).first;
+
+				lastInfo = op.info;
+				lastSet = it != componentStorage.end() ? it->second.get() : nullptr;
+			}
+
+			if (observers.IsActive()) observers.Record(op.info->type, transition.entity, lastSet && lastSet->HasIndex(transition.entity), op.value != nullptr);
+			if (!lastSet) continue;
+
+			if (op.value) lastSet->Emplace(transition.entity, op.value);
+			else lastSet->Delete(transition.entity);
+		}
+	}
+}
+
+void Weave::ECS::World::SetParent(EntityID child, EntityID parent)
+{
+	FlushReservedEntities();
+
+	if (!IsEntityRegistered(child) || !IsEntityRegistered(parent))
+		throw std::logic_error("Entity is not registered.");
+
+	hierarchy.SetParent(child, parent);
+}
+
+void Weave::ECS::World::RemoveParent(EntityID child)
+{
+	hierarchy.RemoveParent(child);
+}
+
+Weave::ECS::EntityID Weave::ECS::World::GetParent(EntityID entity) const
+{
+	return hierarchy.GetParent(entity);
+}
+
+Weave::ECS::Hierarchy::Children Weave::ECS::World::GetChildren(EntityID entity) const
+{
+	return hierarchy.GetChildren(entity);
+}
+
+void Weave::ECS::World::RemoveObserver(ObserverID observer)
+{
+	observers.Remove(observer);
+}
+
+void Weave::ECS::World::NotifyObservers()
+{
+	observers.Notify(*this);
+}
+
+void Weave::ECS::World::AddDynamicComponent(EntityID entity, ComponentID component, const void* value)
+{
+	if (!IsEntityRegistered(entity))
+		throw std::logic_error("Entity is not registered.");
+
+	const ComponentInfo& info = RuntimeComponents::Get().GetInfo(component);
+	ComponentValue copy(info, memoryResource, value);
+
+	auto it = componentStorage.find(info.type);
+	if (it == componentStorage.end()) it = componentStorage.emplace(info.type, info.createSparseSet(memoryResource)).first;
+
+	if (observers.IsActive()) observers.Record(info.type, entity, it->second->HasIndex(entity), true);
+	it->second->Emplace(entity, copy.Get());
+}
+
+void Weave::ECS::World::RemoveDynamicComponent(EntityID entity, ComponentID component)
+{
+	if (!IsEntityRegistered(entity))
+		throw std::logic_error("Entity is not registered.");
+
+	const ComponentInfo& info = RuntimeComponents::Get().GetInfo(component);
+
+	auto it = componentStorage.find(info.type);
+	if (it == componentStorage.end()) return;
+
+	if (observers.IsActive()) observers.Record(info.type, entity, it->second->HasIndex(entity), false);
+	it->second->Delete(entity);
+}
+
+void* Weave::ECS::World::TryGetDynamicComponent(EntityID entity, ComponentID component)
+{
+	if (!IsEntityRegistered(entity)) return nullptr;
+
+	const ComponentInfo& info = RuntimeComponents::Get().GetInfo(component);
+
+	auto it = componentStorage.find(info.type);
+	return it != componentStorage.end() ? it->second->TryGet(entity) : nullptr;
+}
+
+Weave::ECS::DynamicView Weave::ECS::World::GetDynamicView(std::span<const ComponentID>)
+{
+	throw std::logic_error("Dynamic views need the Archetype backend.");
+}
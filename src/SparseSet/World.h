@@ -5,7 +5,23 @@
 #include <set>
 #include <tuple>
 #include <stdexcept>
+#include <limits>
+#include <algorithm>
 #include "SparseSet.h"
+#include <span>
+#include <memory_resource>
+#include <mutex>
+#include "ComponentTraits.h"
+#include "ComponentInfo.h"
+#include "EntityAllocator.h"
+#include "MemoryStats.h"
+#include "Snapshot.h"
+#include "Rollback.h"
+#include "Delta.h"
+#include "MemoryResource.h"
+#include "Hierarchy.h"
+#include "ComponentObservers.h"
+#include "RuntimeComponents.h"
 
 namespace Weave
 {
@@ -17,9 +33,9 @@ namespace Weave
 		class WorldViewIterator 
 		{
 		public:
-			using SparseSetsTuple = std::tuple<SparseSet<Components>&...>;
+			using SparseSetsTuple = std::tuple<SparseSet<Components>*...>;
 
-			WorldViewIterator(std::vector<EntityID>::iterator current, std::vector<EntityID>::iterator end, SparseSetsTuple sets)
+			WorldViewIterator(std::pmr::vector<EntityID>::iterator current, std::pmr::vector<EntityID>::iterator end, SparseSetsTuple sets)
 				: current(current), end(end), sets(std::move(sets)) {}
 
 			bool operator!=(const WorldViewIterator& other) const { return current != other.current; }
@@ -27,21 +43,30 @@ namespace Weave
 
 			auto operator*() {
 				EntityID entity = *current;
-				return std::tuple_cat(std::make_tuple(entity), std::tie(*std::get<SparseSet<Components>&>(sets).Get(entity)...));
+				return std::tuple_cat(std::make_tuple(entity), std::tie(*std::get<SparseSet<Components>*>(sets)->Get(entity)...));
 			}
 
 		private:
-			std::vector<EntityID>::iterator current, end;
+			std::pmr::vector<EntityID>::iterator current, end;
 			SparseSetsTuple sets;
 		};
 
+		// A contiguous range of entities within a view.
+		struct ViewChunk
+		{
+			std::size_t view;
+			std::size_t begin;
+			std::size_t end;
+		};
+
+		// The entities of a view live in the World's view resource, see World::SetViewResource.
 		template<typename... Components>
 		class WorldView 
 		{
 		public:
-			using SparseSetsTuple = std::tuple<SparseSet<Components>&...>;
+			using SparseSetsTuple = std::tuple<SparseSet<Components>*...>;
 
-			WorldView(std::vector<EntityID> entities, SparseSetsTuple sets)
+			WorldView(std::pmr::vector<EntityID> entities, SparseSetsTuple sets)
 				: validEntities(std::move(entities)), sets(std::move(sets)) {}
 
 			WorldViewIterator<Components...> begin() { return WorldViewIterator<Components...>(validEntities.begin(), validEntities.end(), sets); }
@@ -57,17 +82,72 @@ namespace Weave
 				return validEntities.size();
 			}
 
+			std::vector<ViewChunk> Partition(std::size_t maxChunkSize) const
+			{
+				std::vector<ViewChunk> chunks;
+
+				for (std::size_t begin = 0; begin < validEntities.size(); begin += maxChunkSize)
+				{
+					chunks.push_back({ 0, begin, std::min(validEntities.size(), begin + maxChunkSize) });
+				}
+
+				return chunks;
+			}
+
+			// Calls fn(entity, components...) for the entities in the chunk without going through the iterator.
+			template <typename F>
+			void ForEach(const ViewChunk& chunk, F&& fn) const
+			{
+				for (std::size_t index = chunk.begin; index < chunk.end; index++)
+				{
+					EntityID entity = validEntities[index];
+					fn(entity, *std::get<SparseSet<Components>*>(sets)->Get(entity)...);
+				}
+			}
+
+			template <typename F>
+			void ForEach(F&& fn) const
+			{
+				ForEach(ViewChunk{ 0, 0, validEntities.size() }, fn);
+			}
+
 		private:
-			std::vector<EntityID> validEntities;
+			std::pmr::vector<EntityID> validEntities;
 			SparseSetsTuple sets;
 		};
 
 		class World
 		{
 		private:
+			// One snapshot of the rollback ring. Sets created after the snapshot have no copy and are emptied on restore.
+			struct RollbackFrame
+			{
+				std::uint64_t sequence = 0;
+				std::shared_ptr<const EntityAllocator::State> entities;
+				std::shared_ptr<const Hierarchy::State> hierarchy;
+				RollbackCopies<ISparseSet, std::shared_ptr<const SparseSetCopy>> sparseSets;
+			};
+
+			// Sparse sets allocate from memoryResource, views from viewResource.
+			std::pmr::memory_resource* memoryResource;
+			std::pmr::memory_resource* viewResource;
+
 			std::unordered_map<std::type_index, std::unique_ptr<ISparseSet>> componentStorage;
-			std::set<EntityID> availableEntityIDs;
-			EntityID nextEntityID = 0;
+			EntityAllocator entityAllocator;
+
+			Hierarchy hierarchy;
+			ComponentObservers observers;
+
+			// The hierarchy's depth order, rebuilt when the hierarchy changed. hierarchyMutex guards it.
+			HierarchyOrder hierarchyOrder;
+			std::uint64_t hierarchyOrderVersion = std::numeric_limits<std::uint64_t>::max();
+			std::mutex hierarchyMutex;
+
+			std::vector<RollbackFrame> rollbackFrames = std::vector<RollbackFrame>(8);
+			std::uint64_t rollbackSequence = 0;
+
+			// Throws when the snapshot is no longer in the rollback ring.
+			RollbackFrame& GetRollbackFrame(RollbackSnapshot snapshot);
 
 			template<typename T>
 			SparseSet<T>& GetComponentSet()
@@ -76,7 +156,7 @@ namespace Weave
 
 				if (it == componentStorage.end())
 				{
-					std::unique_ptr<ISparseSet> newSet = std::make_unique<SparseSet<T>>();
+					std::unique_ptr<ISparseSet> newSet = std::make_unique<SparseSet<T>>(memoryResource);
 					componentStorage[std::type_index(typeid(T))] = std::move(newSet);
 					it = componentStorage.find(std::type_index(typeid(T)));
 				}
@@ -96,11 +176,133 @@ namespace Weave
 			}
 
 		public:
+			// The resource must outlive the world. It is only used by structural changes, which never run in parallel,
+			// so it needn't be thread safe: ChunkPool and HugePageResource both work. See also SetViewResource.
+			explicit World(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+			// Resource the entity lists of views are allocated from, std::pmr::get_default_resource() by default. Systems
+			// running in parallel build views at the same time, so it must be thread safe, which rules out ChunkPool.
+			// A FrameArena makes building views nearly free, reset it once the views of a frame are gone.
+			void SetViewResource(std::pmr::memory_resource* resource);
+
 			EntityID CreateEntity();
 			void DeleteEntity(EntityID entity);
 
+			// Returns an ID that is usable in buffered commands right away, safe to call from any thread while systems run.
+			// The entity becomes alive on the next FlushReservedEntities, which CommandBuffer::Flush and CreateEntity call.
+			EntityID ReserveEntity();
+			void FlushReservedEntities();
+
 			bool IsEntityRegistered(EntityID entity) const;
 
+			WorldMemoryStats GetMemoryStats() const;
+
+			// Saves every entity and component, all component types must be registered with the ComponentRegistry.
+			void SaveSnapshot(const std::string& path);
+
+			// Replaces the world's contents with a snapshot. Sparse sets always copy, so the mode is ignored.
+			void LoadSnapshot(const std::string& path, SnapshotLoadMode mode = SnapshotLoadMode::Adopt);
+
+			// Saves the world into the rollback ring, overwriting the oldest snapshot once it is full. Sparse sets that
+			// haven't changed since they were last captured or restored are shared with the snapshot before. Any
+			// non-const access counts as a change, and views or component pointers taken before the snapshot must not
+			// be written through after it.
+			RollbackSnapshot Snapshot();
+
+			// Returns the world to a snapshot that is still in the ring, only sets that changed since are copied back.
+			// Throws when the snapshot was overwritten. Later snapshots stay valid.
+			void Restore(RollbackSnapshot snapshot);
+
+			// Number of snapshots the ring holds, 8 by default. Drops every snapshot taken so far.
+			void SetRollbackCapacity(std::size_t capacity);
+
+			// Encodes what changed from baseline to target, both snapshots in the ring, for replication. A default
+			// constructed baseline stands for an empty world. Only sparse sets whose copies differ are compared.
+			// Every component type must be registered with the ComponentRegistry.
+			std::vector<std::byte> ExtractDelta(RollbackSnapshot baseline, RollbackSnapshot target);
+
+			// Applies a delta to a world that mirrors the sender's entity IDs and is at the delta's baseline.
+			// Returns the target snapshot's sequence, to acknowledge as the next baseline.
+			std::uint64_t ApplyDelta(std::span<const std::byte> delta);
+
+			// Applies the net structural change of many entities at once, see EntityTransition.
+			void ApplyTransitions(std::span<const EntityTransition> transitions);
+
+			// Observers get the entities that gained, lost or overwrote a component of the type, batched per type and
+			// event and delivered by NotifyObservers, which CommandBuffer::Flush calls. Loading and restoring
+			// snapshots isn't observed and drops the events not delivered yet.
+			template<typename T>
+			ObserverID OnAdd(ComponentObserver observer)
+			{
+				return observers.Add(typeid(T), ComponentEvent::Add, std::move(observer));
+			}
+
+			template<typename T>
+			ObserverID OnRemove(ComponentObserver observer)
+			{
+				return observers.Add(typeid(T), ComponentEvent::Remove, std::move(observer));
+			}
+
+			template<typename T>
+			ObserverID OnSet(ComponentObserver observer)
+			{
+				return observers.Add(typeid(T), ComponentEvent::Set, std::move(observer));
+			}
+
+			void RemoveObserver(ObserverID observer);
+			void NotifyObservers();
+
+			// Makes child the last child of parent, moving it from its current parent. Throws when either entity isn't
+			// registered or parent is child or one of its descendants. Deleting an entity turns its children into roots.
+			void SetParent(EntityID child, EntityID parent);
+			void RemoveParent(EntityID child);
+
+			// NoEntity for entities without a parent.
+			EntityID GetParent(EntityID entity) const;
+			Hierarchy::Children GetChildren(EntityID entity) const;
+
+			// Every entity in a hierarchy that has the components, by depth so parents come before their children.
+			// Safe to call from systems running at the same time.
+			template<typename... ComponentTypes>
+			HierarchyView<ComponentTypes...> GetHierarchyView()
+			{
+				HierarchyView<ComponentTypes...> view(viewResource);
+				std::tuple<SparseSet<ComponentTypes>*...> sets(TryGetComponentSet<ComponentTypes>()...);
+
+				if ((!std::get<SparseSet<ComponentTypes>*>(sets) || ...)) return view;
+
+				std::lock_guard<std::mutex> lock(hierarchyMutex);
+
+				if (hierarchyOrderVersion != hierarchy.GetVersion())
+				{
+					hierarchy.BuildOrder(hierarchyOrder);
+					hierarchyOrderVersion = hierarchy.GetVersion();
+				}
+
+				// Index of every entity of the order in the view, NoEntity for those left out.
+				std::pmr::vector<std::size_t> viewIndexes(hierarchyOrder.entities.size(), NoEntity, viewResource);
+				view.Reserve(hierarchyOrder.entities.size());
+
+				for (std::size_t depth = 0; depth + 1 < hierarchyOrder.levels.size(); depth++)
+				{
+					for (std::size_t index = hierarchyOrder.levels[depth]; index < hierarchyOrder.levels[depth + 1]; index++)
+					{
+						EntityID entity = hierarchyOrder.entities[index];
+						std::tuple<ComponentTypes*...> components(std::get<SparseSet<ComponentTypes>*>(sets)->Get(entity)...);
+
+						if ((!std::get<ComponentTypes*>(components) || ...)) continue;
+
+						std::size_t parent = hierarchyOrder.parents[index] != NoEntity ? viewIndexes[hierarchyOrder.parents[index]] : NoEntity;
+						viewIndexes[index] = view.GetEntityCount();
+						view.Add(entity, parent, components);
+					}
+
+					view.EndLevel();
+				}
+
+				return view;
+			}
+
 			template<typename T>
 			void AddComponent(EntityID entity, T component = T())
 			{
@@ -108,6 +310,8 @@ namespace Weave
 					throw std::logic_error("Entity is not registered.");
 
 				SparseSet<T>& set = GetComponentSet<T>();
+				if (observers.IsActive()) observers.Record(typeid(T), entity, set.HasIndex(entity), true);
+
 				set.Set(entity, component);
 			}
 
@@ -133,6 +337,7 @@ namespace Weave
 
 				if (!componentSet) return;
 
+				if (observers.IsActive()) observers.Record(typeid(T), entity, componentSet->HasIndex(entity), false);
 				componentSet->Delete(entity);
 			}
 
@@ -154,30 +359,42 @@ namespace Weave
 				return componentSet->Get(entity);
 			}
 
+			// Components by ID, see RuntimeComponents. The value is copied, a null value default constructs the
+			// component. Types defined at runtime need the Archetype backend, adding one throws.
+			void AddDynamicComponent(EntityID entity, ComponentID component, const void* value = nullptr);
+			void RemoveDynamicComponent(EntityID entity, ComponentID component);
+			void* TryGetDynamicComponent(EntityID entity, ComponentID component);
+
+			// Components of one entity aren't stored in rows side by side, so there are no columns to return. Throws.
+			DynamicView GetDynamicView(std::span<const ComponentID> components);
+
+			// Only looks storage up, so systems running at the same time can build views.
 			template<typename... ComponentTypes>
 			WorldView<ComponentTypes...> GetView()
 			{
-				auto sets = std::forward_as_tuple(GetComponentSet<ComponentTypes>()...);
+				std::tuple<SparseSet<ComponentTypes>*...> sets(TryGetComponentSet<ComponentTypes>()...);
+				std::pmr::vector<EntityID> valid(viewResource);
+
+				if ((!std::get<SparseSet<ComponentTypes>*>(sets) || ...)) return WorldView<ComponentTypes...>(std::move(valid), sets);
 
-				std::vector<EntityID> baseEntities;
+				std::span<const EntityID> baseEntities;
 				std::size_t minSize = std::numeric_limits<std::size_t>::max();
 
 				([&] {
-					auto& set = GetComponentSet<ComponentTypes>();
-					if (set.Size() < minSize) {
-						baseEntities = set.GetIndexes();
-						minSize = set.Size();
+					SparseSet<ComponentTypes>* set = std::get<SparseSet<ComponentTypes>*>(sets);
+					if (set->Size() < minSize) {
+						baseEntities = set->GetDenseIndexes();
+						minSize = set->Size();
 					}
 					}(), ...);
 
-				std::vector<EntityID> valid;
 				for (EntityID entity : baseEntities) {
-					if ((GetComponentSet<ComponentTypes>().HasIndex(entity) && ...)) {
+					if ((std::get<SparseSet<ComponentTypes>*>(sets)->HasIndex(entity) && ...)) {
 						valid.push_back(entity);
 					}
 				}
 
-				return WorldView<ComponentTypes...>(std::move(valid), std::forward_as_tuple(GetComponentSet<ComponentTypes>()...));
+				return WorldView<ComponentTypes...>(std::move(valid), sets);
 			}
 		};
 	}
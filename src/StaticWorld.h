@@ -0,0 +1,295 @@
+#pragma once
+#include <array>
+#include <tuple>
+#include <span>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <memory_resource>
+#include <cstdint>
+#include <cstddef>
+#include "SparseSet/SparseSet.h"
+#include "EntityAllocator.h"
+#include "World.h"
+
+namespace Weave
+{
+	namespace ECS
+	{
+		// Position of T in Components, resolved at compile time.
+		template <typename T, typename... Components>
+		constexpr std::size_t StaticComponentIndex()
+		{
+			static_assert((std::is_same_v<T, Components> || ...), "Component type is not part of the StaticWorld.");
+
+			std::size_t index = 0;
+			((std::is_same_v<T, Components> ? false : (index++, true)) && ...);
+			return index;
+		}
+
+		// The components an entity of a StaticWorld has, one bit per type in declaration order.
+		template <std::size_t ComponentCount>
+		struct StaticSignature
+		{
+			std::array<std::uint64_t, (ComponentCount + 63) / 64> words{};
+
+			constexpr void Set(std::size_t index, bool value)
+			{
+				std::uint64_t bit = std::uint64_t(1) << (index % 64);
+				words[index / 64] = value ? words[index / 64] | bit : words[index / 64] & ~bit;
+			}
+
+			constexpr bool Test(std::size_t index) const
+			{
+				return words[index / 64] >> (index % 64) & 1;
+			}
+
+			constexpr bool Contains(const StaticSignature& mask) const
+			{
+				for (std::size_t word = 0; word < words.size(); word++)
+				{
+					if ((words[word] & mask.words[word]) != mask.words[word]) return false;
+				}
+
+				return true;
+			}
+		};
+
+		template <typename... Components>
+		class StaticWorldView
+		{
+		private:
+			std::pmr::vector<EntityID> entities;
+			std::tuple<SparseSet<Components>*...> sets;
+
+		public:
+			StaticWorldView(std::pmr::vector<EntityID> entities, std::tuple<SparseSet<Components>*...> sets)
+				: entities(std::move(entities)), sets(sets) {}
+
+			std::size_t GetEntityCount() const
+			{
+				return entities.size();
+			}
+
+			std::span<const EntityID> GetEntities() const
+			{
+				return entities;
+			}
+
+			std::vector<ViewChunk> Partition(std::size_t maxChunkSize) const
+			{
+				std::vector<ViewChunk> chunks;
+
+				for (std::size_t begin = 0; begin < entities.size(); begin += maxChunkSize)
+				{
+					chunks.push_back({ 0, begin, std::min(entities.size(), begin + maxChunkSize) });
+				}
+
+				return chunks;
+			}
+
+			template <typename F>
+			void ForEach(const ViewChunk& chunk, F&& fn) const
+			{
+				for (std::size_t index = chunk.begin; index < chunk.end; index++)
+				{
+					EntityID entity = entities[index];
+					fn(entity, *std::get<SparseSet<Components>*>(sets)->Get(entity)...);
+				}
+			}
+
+			template <typename F>
+			void ForEach(F&& fn) const
+			{
+				ForEach(ViewChunk{ 0, 0, entities.size() }, fn);
+			}
+		};
+
+		// A world whose component types are all known at compile time, for builds that don't add types at runtime.
+		// Each type has a sparse set at a fixed position of a tuple, so looking storage up costs nothing, and
+		// every entity keeps a signature of its types, so a view tests all of its components with one mask
+		// compare. Offers the entity, component and view calls of World. Snapshots, rollback, hierarchies and
+		// observers stay with World, and structural changes aren't buffered through a CommandBuffer.
+		template <typename... Components>
+		class StaticWorld
+		{
+		public:
+			using Signature = StaticSignature<sizeof...(Components)>;
+
+			template <typename T>
+			static constexpr std::size_t IndexOf = StaticComponentIndex<T, Components...>();
+
+			template <typename... QueryComponents>
+			static constexpr Signature MaskOf()
+			{
+				Signature mask;
+				(mask.Set(IndexOf<QueryComponents>, true), ...);
+				return mask;
+			}
+
+		private:
+			std::pmr::memory_resource* viewResource;
+
+			std::tuple<SparseSet<Components>...> componentStorage;
+			EntityAllocator entityAllocator;
+			std::pmr::vector<Signature> signatures;
+
+			template <typename T>
+			SparseSet<T>& GetComponentSet()
+			{
+				return std::get<IndexOf<T>>(componentStorage);
+			}
+
+			Signature& GetSignature(EntityID entity)
+			{
+				if (entity >= signatures.size()) signatures.resize(entity + 1);
+				return signatures[entity];
+			}
+
+		public:
+			// The resource must outlive the world. Sparse sets can't be moved, so each is constructed in place from resource.
+			explicit StaticWorld(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+				: viewResource(resource), componentStorage(((void)sizeof(Components), resource)...), signatures(resource) {}
+
+			StaticWorld(const StaticWorld&) = delete;
+			StaticWorld& operator=(const StaticWorld&) = delete;
+
+			void SetViewResource(std::pmr::memory_resource* resource)
+			{
+				viewResource = resource;
+			}
+
+			EntityID CreateEntity()
+			{
+				FlushReservedEntities();
+
+				EntityID entity = entityAllocator.Allocate();
+				GetSignature(entity) = Signature();
+
+				return entity;
+			}
+
+			void DeleteEntity(EntityID entity)
+			{
+				FlushReservedEntities();
+
+				if (!IsEntityRegistered(entity))
+					throw std::logic_error("Entity is not registered.");
+
+				const Signature& signature = signatures[entity];
+				([&] {
+					if (signature.Test(IndexOf<Components>)) GetComponentSet<Components>().Delete(entity);
+					}(), ...);
+
+				signatures[entity] = Signature();
+				entityAllocator.Free(entity);
+			}
+
+			// See World::ReserveEntity.
+			EntityID ReserveEntity()
+			{
+				return entityAllocator.Reserve();
+			}
+
+			void FlushReservedEntities()
+			{
+				if (entityAllocator.HasReserved()) entityAllocator.FlushReserved([this](EntityID entity) { GetSignature(entity) = Signature(); });
+			}
+
+			bool IsEntityRegistered(EntityID entity) const
+			{
+				return entityAllocator.IsAlive(entity);
+			}
+
+			template <typename T>
+			void AddComponent(EntityID entity, T component = T())
+			{
+				if (!IsEntityRegistered(entity))
+					throw std::logic_error("Entity is not registered.");
+
+				GetComponentSet<T>().Set(entity, std::move(component));
+				signatures[entity].Set(IndexOf<T>, true);
+			}
+
+			template <typename... AddedComponents>
+			void AddComponents(EntityID entity)
+			{
+				(AddComponent<AddedComponents>(entity), ...);
+			}
+
+			template <typename... AddedComponents>
+			void AddComponents(EntityID entity, AddedComponents... components)
+			{
+				(AddComponent<AddedComponents>(entity, std::move(components)), ...);
+			}
+
+			template <typename T>
+			void RemoveComponent(EntityID entity)
+			{
+				if (!IsEntityRegistered(entity))
+					throw std::logic_error("Entity is not registered.");
+
+				GetComponentSet<T>().Delete(entity);
+				signatures[entity].Set(IndexOf<T>, false);
+			}
+
+			template <typename... RemovedComponents>
+			void RemoveComponents(EntityID entity)
+			{
+				(RemoveComponent<RemovedComponents>(entity), ...);
+			}
+
+			template <typename T>
+			T* TryGetComponent(EntityID entity)
+			{
+				if (!IsEntityRegistered(entity)) return nullptr;
+
+				return GetComponentSet<T>().Get(entity);
+			}
+
+			template <typename... QueryComponents>
+			bool HasComponents(EntityID entity) const
+			{
+				return IsEntityRegistered(entity) && signatures[entity].Contains(MaskOf<QueryComponents...>());
+			}
+
+			// Entities with every component, walking the smallest of their sets.
+			template <typename... QueryComponents>
+			StaticWorldView<QueryComponents...> GetView()
+			{
+				static constexpr Signature mask = MaskOf<QueryComponents...>();
+
+				std::span<const EntityID> baseEntities;
+				std::size_t minSize = std::numeric_limits<std::size_t>::max();
+
+				([&] {
+					SparseSet<QueryComponents>& set = GetComponentSet<QueryComponents>();
+					if (set.Size() < minSize)
+					{
+						baseEntities = set.GetDenseIndexes();
+						minSize = set.Size();
+					}
+					}(), ...);
+
+				std::pmr::vector<EntityID> valid(viewResource);
+
+				if constexpr (sizeof...(QueryComponents) == 1)
+				{
+					valid.assign(baseEntities.begin(), baseEntities.end());
+				}
+				else
+				{
+					valid.reserve(baseEntities.size());
+
+					for (EntityID entity : baseEntities)
+					{
+						if (signatures[entity].Contains(mask)) valid.push_back(entity);
+					}
+				}
+
+				return StaticWorldView<QueryComponents...>(std::move(valid), std::tuple<SparseSet<QueryComponents>*...>(&GetComponentSet<QueryComponents>()...));
+			}
+		};
+	}
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <set>
+#include <typeindex>
+#include <algorithm>
+
+namespace Weave
+{
+	namespace ECS
+	{
+		template <typename Component>
+		struct Read {};
+
+		template <typename Component>
+		struct Write {};
+
+		// The system's buffered commands add or remove Component.
+		template <typename Component>
+		struct Structural {};
+
+		// The components a system touches. Systems whose access does not conflict may run at the same time,
+		// systems with unknown (exclusive) access run on their own.
+		struct SystemAccess
+		{
+			std::set<std::type_index> reads;
+			std::set<std::type_index> writes;
+
+			// Structural systems record commands, structuralChanges lists the components those commands add or remove.
+			// When it is empty the commands may change anything.
+			std::set<std::type_index> structuralChanges;
+
+			bool exclusive = false;
+			bool structural = false;
+
+			static SystemAccess Exclusive()
+			{
+				SystemAccess access;
+				access.exclusive = true;
+				return access;
+			}
+
+			template <typename... Accesses>
+			static SystemAccess Of()
+			{
+				SystemAccess access;
+				(access.Declare(static_cast<Accesses*>(nullptr)), ...);
+				return access;
+			}
+
+			template <typename Component>
+			void Declare(Read<Component>*)
+			{
+				DeclareRead(typeid(Component));
+			}
+
+			template <typename Component>
+			void Declare(Write<Component>*)
+			{
+				DeclareWrite(typeid(Component));
+			}
+
+			// For types only known at runtime, by the type of their ComponentInfo.
+			void DeclareRead(std::type_index type)
+			{
+				if (!writes.contains(type)) reads.insert(type);
+			}
+
+			void DeclareWrite(std::type_index type)
+			{
+				reads.erase(type);
+				writes.insert(type);
+			}
+
+			template <typename Component>
+			void Declare(Structural<Component>*)
+			{
+				structural = true;
+				structuralChanges.insert(typeid(Component));
+			}
+
+			bool Touches(std::type_index type) const
+			{
+				return reads.contains(type) || writes.contains(type);
+			}
+
+			// True when applying this system's commands may change what a system with the other access sees.
+			bool StructurallyAffects(const SystemAccess& other) const
+			{
+				if (!structural) return false;
+				if (other.exclusive) return true;
+				if (structuralChanges.empty()) return !other.reads.empty() || !other.writes.empty();
+
+				return std::any_of(structuralChanges.begin(), structuralChanges.end(), [&other](const std::type_index& type) { return other.Touches(type); });
+			}
+
+			// Adds everything other touches, used to describe a set of systems as one.
+			void Merge(const SystemAccess& other)
+			{
+				bool unknownChanges = (structural && structuralChanges.empty()) || (other.structural && other.structuralChanges.empty());
+
+				reads.insert(other.reads.begin(), other.reads.end());
+				writes.insert(other.writes.begin(), other.writes.end());
+				for (const std::type_index& type : writes) reads.erase(type);
+
+				structuralChanges.insert(other.structuralChanges.begin(), other.structuralChanges.end());
+				if (unknownChanges) structuralChanges.clear();
+
+				exclusive = exclusive || other.exclusive;
+				structural = structural || other.structural;
+			}
+
+			bool ConflictsWith(const SystemAccess& other) const
+			{
+				// Commands are only recorded while systems run, so structural systems do not conflict for that alone.
+				if (exclusive || other.exclusive) return true;
+
+				auto intersects = [](const std::set<std::type_index>& a, const std::set<std::type_index>& b)
+					{
+						return std::any_of(a.begin(), a.end(), [&b](const std::type_index& type) { return b.contains(type); });
+					};
+
+				return intersects(writes, other.writes) || intersects(writes, other.reads) || intersects(reads, other.writes);
+			}
+		};
+	}
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "ECS.h"
+#include "CommandBuffer.h"
+
+namespace Weave
+{
+	namespace ECS
+	{
+		// Runs one system. The callable keeps its concrete type, so a whole system costs one virtual call
+		// and the per entity loop inside it can be inlined.
+		class ISystemExecutor
+		{
+		public:
+			virtual ~ISystemExecutor() = default;
+
+			// Returns how many entities the system processed, 0 when it iterates the World on its own.
+			virtual std::size_t Execute(World& world) = 0;
+		};
+
+		template <typename F>
+		class SystemExecutor : public ISystemExecutor
+		{
+		private:
+			F fn;
+
+		public:
+			explicit SystemExecutor(F fn)
+				: fn(std::move(fn)) {}
+
+			std::size_t Execute(World& world) override
+			{
+				if constexpr (std::is_void_v<std::invoke_result_t<F&, World&>>)
+				{
+					fn(world);
+					return 0;
+				}
+				else
+				{
+					return fn(world);
+				}
+			}
+		};
+
+		template <typename... Ts>
+		struct TypeList {};
+
+		template <typename F>
+		struct CallableTraits {};
+
+		template <typename F>
+		requires requires { &F::operator(); }
+		struct CallableTraits<F> : CallableTraits<decltype(&F::operator())> {};
+
+		template <typename R, typename... Args>
+		struct CallableTraits<R(*)(Args...)>
+		{
+			using Arguments = TypeList<Args...>;
+		};
+
+		template <typename R, typename... Args>
+		struct CallableTraits<R(Args...)> : CallableTraits<R(*)(Args...)> {};
+
+		template <typename C, typename R, typename... Args>
+		struct CallableTraits<R(C::*)(Args...)> : CallableTraits<R(*)(Args...)> {};
+
+		template <typename C, typename R, typename... Args>
+		struct CallableTraits<R(C::*)(Args...) const> : CallableTraits<R(*)(Args...)> {};
+
+		template <typename Arguments>
+		struct SystemSignature
+		{
+			static constexpr bool valid = false;
+			using Components = TypeList<>;
+			static constexpr bool usesCommandBuffer = false;
+		};
+
+		// Splits (EntityID, components..., [CommandBuffer&]) into the component types and whether a buffer is taken.
+		template <typename First, typename... Rest>
+		struct SystemSignature<TypeList<First, Rest...>>
+		{
+		private:
+			template <typename Collected, typename... Remaining>
+			struct Collect;
+
+			template <typename... Collected>
+			struct Collect<TypeList<Collected...>>
+			{
+				using Components = TypeList<Collected...>;
+				static constexpr bool usesCommandBuffer = false;
+			};
+
+			template <typename... Collected>
+			struct Collect<TypeList<Collected...>, CommandBuffer&>
+			{
+				using Components = TypeList<Collected...>;
+				static constexpr bool usesCommandBuffer = true;
+			};
+
+			template <typename... Collected, typename Next, typename... Remaining>
+			struct Collect<TypeList<Collected...>, Next, Remaining...> : Collect<TypeList<Collected..., std::remove_cvref_t<Next>>, Remaining...> {};
+
+		public:
+			static constexpr bool valid = std::is_same_v<std::remove_cvref_t<First>, EntityID>;
+			using Components = typename Collect<TypeList<>, Rest...>::Components;
+			static constexpr bool usesCommandBuffer = Collect<TypeList<>, Rest...>::usesCommandBuffer;
+		};
+
+		template <typename F>
+		using CallableSignature = SystemSignature<typename CallableTraits<std::remove_cvref_t<F>>::Arguments>;
+
+		template <typename... Ts>
+		constexpr std::size_t TypeListSize(TypeList<Ts...>*) { return sizeof...(Ts); }
+
+		// A per entity system whose component types can be read from a non generic call operator.
+		template <typename F>
+		concept DeducibleSystem = requires { typename CallableTraits<std::remove_cvref_t<F>>::Arguments; }
+			&& CallableSignature<F>::valid
+			&& TypeListSize(static_cast<typename CallableSignature<F>::Components*>(nullptr)) > 0;
+	}
+}
@@ -0,0 +1,155 @@
+#include "PerfCounters.h"
+#include <utility>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+namespace
+{
+    thread_local Weave::Utilities::PerfCounterScope* currentScope = nullptr;
+
+#if defined(__linux__)
+    constexpr int CounterCount = 5;
+
+    // One group per thread, read with a single syscall. Cycles lead the group, every other counter is optional.
+    class ThreadCounterGroup
+    {
+    private:
+        int descriptors[CounterCount] = { -1, -1, -1, -1, -1 };
+        int positions[CounterCount] = { -1, -1, -1, -1, -1 }; // Index of each counter in the group read, -1 if it couldn't be opened.
+        int opened = 0;
+
+        static int Open(std::uint32_t type, std::uint64_t config, int leader)
+        {
+            perf_event_attr attributes;
+            std::memset(&attributes, 0, sizeof(attributes));
+            attributes.size = sizeof(attributes);
+            attributes.type = type;
+            attributes.config = config;
+            attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+
+            return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, leader, 0));
+        }
+
+    public:
+        ThreadCounterGroup()
+        {
+            constexpr std::uint64_t l1dReadMiss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+            const std::pair<std::uint32_t, std::uint64_t> events[CounterCount] = {
+                { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+                { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+                { PERF_TYPE_HW_CACHE, l1dReadMiss },
+                { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+                { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+            };
+
+            for (int counter = 0; counter < CounterCount; counter++)
+            {
+                descriptors[counter] = Open(events[counter].first, events[counter].second, counter == 0 ? -1 : descriptors[0]);
+
+                if (descriptors[counter] >= 0) positions[counter] = opened++;
+                else if (counter == 0) return;
+            }
+        }
+
+        ~ThreadCounterGroup()
+        {
+            for (int descriptor : descriptors)
+            {
+                if (descriptor >= 0) close(descriptor);
+            }
+        }
+
+        bool IsAvailable() const
+        {
+            return opened > 0;
+        }
+
+        bool Read(Weave::Utilities::PerfCounterValues& values) const
+        {
+            if (!IsAvailable()) return false;
+
+            // nr, time enabled, time running, then one value per opened counter.
+            std::uint64_t buffer[3 + CounterCount];
+            ssize_t expected = static_cast<ssize_t>((3 + opened) * sizeof(std::uint64_t));
+            if (read(descriptors[0], buffer, sizeof(buffer)) != expected) return false;
+
+            // The group is time shared with other users of the PMU, scale to the whole time it was enabled.
+            double scale = buffer[2] > 0 && buffer[2] < buffer[1] ? static_cast<double>(buffer[1]) / static_cast<double>(buffer[2]) : 1.0;
+
+            std::uint64_t* targets[CounterCount] = { &values.cycles, &values.instructions, &values.l1dMisses, &values.llcMisses, &values.branchMisses };
+
+            for (int counter = 0; counter < CounterCount; counter++)
+            {
+                *targets[counter] = positions[counter] >= 0 ? static_cast<std::uint64_t>(static_cast<double>(buffer[3 + positions[counter]]) * scale) : 0;
+            }
+
+            return true;
+        }
+    };
+
+    ThreadCounterGroup& GetThreadCounterGroup()
+    {
+        thread_local ThreadCounterGroup group;
+        return group;
+    }
+#endif
+}
+
+bool Weave::Utilities::PerfCounters::Read(PerfCounterValues& values)
+{
+#if defined(__linux__)
+    return GetThreadCounterGroup().Read(values);
+#else
+    (void)values;
+    return false;
+#endif
+}
+
+bool Weave::Utilities::PerfCounters::IsAvailable()
+{
+#if defined(__linux__)
+    return GetThreadCounterGroup().IsAvailable();
+#else
+    return false;
+#endif
+}
+
+Weave::Utilities::PerfCounterSink* Weave::Utilities::PerfCounters::GetCurrentSink()
+{
+    return currentScope ? currentScope->sink : nullptr;
+}
+
+Weave::Utilities::PerfCounterScope::PerfCounterScope(PerfCounterSink* sink)
+    : sink(sink), outer(currentScope)
+{
+    active = PerfCounters::Read(start);
+
+    if (active && outer && outer->active)
+    {
+        if (outer->sink) outer->sink->Add(start - outer->start);
+    }
+
+    currentScope = this;
+}
+
+Weave::Utilities::PerfCounterScope::~PerfCounterScope()
+{
+    currentScope = outer;
+    if (!active) return;
+
+    PerfCounterValues end;
+    if (!PerfCounters::Read(end)) return;
+
+    if (sink) sink->Add(end - start);
+
+    // The outer scope resumes from here, the nested work is already attributed.
+    if (outer) outer->start = end;
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace Weave
+{
+    namespace Utilities
+    {
+        // Hardware counters of one thread. Counters the CPU or kernel doesn't provide stay at zero.
+        struct PerfCounterValues
+        {
+            std::uint64_t cycles = 0;
+            std::uint64_t instructions = 0;
+            std::uint64_t l1dMisses = 0;
+            std::uint64_t llcMisses = 0;
+            std::uint64_t branchMisses = 0;
+
+            PerfCounterValues& operator+=(const PerfCounterValues& other)
+            {
+                cycles += other.cycles;
+                instructions += other.instructions;
+                l1dMisses += other.l1dMisses;
+                llcMisses += other.llcMisses;
+                branchMisses += other.branchMisses;
+                return *this;
+            }
+
+            // Counters are monotonic, a smaller value on the right only happens when multiplexing rescales them.
+            friend PerfCounterValues operator-(const PerfCounterValues& a, const PerfCounterValues& b)
+            {
+                auto difference = [](std::uint64_t x, std::uint64_t y) { return x > y ? x - y : 0; };
+
+                return { difference(a.cycles, b.cycles), difference(a.instructions, b.instructions), difference(a.l1dMisses, b.l1dMisses),
+                    difference(a.llcMisses, b.llcMisses), difference(a.branchMisses, b.branchMisses) };
+            }
+        };
+
+        // Sums counter deltas added from any number of threads.
+        class PerfCounterSink
+        {
+        private:
+            std::atomic<std::uint64_t> cycles = 0;
+            std::atomic<std::uint64_t> instructions = 0;
+            std::atomic<std::uint64_t> l1dMisses = 0;
+            std::atomic<std::uint64_t> llcMisses = 0;
+            std::atomic<std::uint64_t> branchMisses = 0;
+
+        public:
+            void Add(const PerfCounterValues& delta)
+            {
+                cycles.fetch_add(delta.cycles, std::memory_order_relaxed);
+                instructions.fetch_add(delta.instructions, std::memory_order_relaxed);
+                l1dMisses.fetch_add(delta.l1dMisses, std::memory_order_relaxed);
+                llcMisses.fetch_add(delta.llcMisses, std::memory_order_relaxed);
+                branchMisses.fetch_add(delta.branchMisses, std::memory_order_relaxed);
+            }
+
+            PerfCounterValues Load() const
+            {
+                return { cycles.load(std::memory_order_relaxed), instructions.load(std::memory_order_relaxed), l1dMisses.load(std::memory_order_relaxed),
+                    llcMisses.load(std::memory_order_relaxed), branchMisses.load(std::memory_order_relaxed) };
+            }
+
+            void Reset()
+            {
+                cycles.store(0, std::memory_order_relaxed);
+                instructions.store(0, std::memory_order_relaxed);
+                l1dMisses.store(0, std::memory_order_relaxed);
+                llcMisses.store(0, std::memory_order_relaxed);
+                branchMisses.store(0, std::memory_order_relaxed);
+            }
+        };
+
+        // Per thread perf_event_open counter groups, opened the first time a thread reads them. Everything reports
+        // unavailable on platforms other than Linux and when the kernel refuses, e.g. without a PMU in a virtual
+        // machine or with a strict perf_event_paranoid.
+        class PerfCounters
+        {
+        public:
+            // Reads the calling thread's counters, false when they are unavailable.
+            static bool Read(PerfCounterValues& values);
+            static bool IsAvailable();
+
+            // Sink of the innermost PerfCounterScope on the calling thread, null outside of one.
+            static PerfCounterSink* GetCurrentSink();
+        };
+
+        // Adds the calling thread's counters to a sink for as long as the scope lives. A nested scope pauses the
+        // one around it, so work is attributed to the innermost scope only. A null sink counts nothing but still
+        // pauses the outer scope.
+        class PerfCounterScope
+        {
+        private:
+            PerfCounterSink* sink;
+            PerfCounterScope* outer;
+            PerfCounterValues start;
+            bool active;
+
+            friend class PerfCounters;
+
+        public:
+            explicit PerfCounterScope(PerfCounterSink* sink);
+            ~PerfCounterScope();
+
+            PerfCounterScope(const PerfCounterScope&) = delete;
+            PerfCounterScope& operator=(const PerfCounterScope&) = delete;
+        };
+    }
+}
+
+#define WEAVE_PERF_CONCAT_INNER(a, b) a##b
+#define WEAVE_PERF_CONCAT(a, b) WEAVE_PERF_CONCAT_INNER(a, b)
+
+#ifdef WEAVE_ENABLE_PERF_COUNTERS
+#define WEAVE_PERF_COUNTER_SCOPE(sink) ::Weave::Utilities::PerfCounterScope WEAVE_PERF_CONCAT(weavePerfCounterScope, __LINE__)(sink)
+#else
+#define WEAVE_PERF_COUNTER_SCOPE(sink) ((void)0)
+#endif
@@ -0,0 +1,135 @@
+#include "Profiler.h"
+#include "MemoryStats.h"
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <cmath>
+
+namespace
+{
+    void WriteJsonString(std::ostream& stream, std::string_view text)
+    {
+        stream << '"';
+
+        for (char c : text)
+        {
+            switch (c)
+            {
+            case '"': stream << "\\\""; break;
+            case '\\': stream << "\\\\"; break;
+            case '\n': stream << "\\n"; break;
+            case '\t': stream << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    stream << escaped;
+                }
+                else
+                {
+                    stream << c;
+                }
+            }
+        }
+
+        stream << '"';
+    }
+
+    void WriteNumber(std::ostream& stream, double value)
+    {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.17g", std::isfinite(value) ? value : 0.0);
+        stream << text;
+    }
+
+    void WriteMicroseconds(std::ostream& stream, std::uint64_t nanoseconds)
+    {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%llu.%03llu", static_cast<unsigned long long>(nanoseconds / 1000), static_cast<unsigned long long>(nanoseconds % 1000));
+        stream << text;
+    }
+}
+
+void Weave::Utilities::Profiler::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (std::unique_ptr<ThreadBuffer>& buffer : buffers)
+    {
+        buffer->written.store(0, std::memory_order_relaxed);
+    }
+}
+
+void Weave::Utilities::Profiler::ExportChromeTrace(std::ostream& stream)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    stream << "{\"traceEvents\":[";
+    bool first = true;
+
+    auto separate = [&]()
+        {
+            if (!first) stream << ',';
+            stream << '\n';
+            first = false;
+        };
+
+    for (std::unique_ptr<ThreadBuffer>& buffer : buffers)
+    {
+        separate();
+        stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->thread << ",\"args\":{\"name\":";
+        WriteJsonString(stream, buffer->name);
+        stream << "}}";
+
+        std::uint64_t written = buffer->written.load(std::memory_order_acquire);
+        std::uint64_t oldest = written > buffer->capacity ? written - buffer->capacity : 0;
+
+        for (std::uint64_t index = oldest; index < written; index++)
+        {
+            const Event& event = buffer->events[index % buffer->capacity];
+
+            separate();
+            stream << "{\"name\":";
+            WriteJsonString(stream, event.name);
+
+            if (event.type == EventType::Counter)
+            {
+                stream << ",\"ph\":\"C\",\"pid\":1,\"ts\":";
+                WriteMicroseconds(stream, event.begin);
+                stream << ",\"args\":{\"value\":";
+                WriteNumber(stream, event.value);
+                stream << "}}";
+                continue;
+            }
+
+            stream << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread << ",\"ts\":";
+            WriteMicroseconds(stream, event.begin);
+            stream << ",\"dur\":";
+            WriteMicroseconds(stream, std::max(event.end, event.begin) - event.begin);
+            stream << '}';
+        }
+    }
+
+    stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+bool Weave::Utilities::Profiler::WriteChromeTrace(const std::string& path)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    ExportChromeTrace(file);
+    return static_cast<bool>(file);
+}
+
+void Weave::Utilities::RecordMemoryCounters(const ECS::WorldMemoryStats& stats)
+{
+    Profiler& profiler = Profiler::Get();
+
+    profiler.RecordCounter("World Bytes Allocated", static_cast<double>(stats.bytesAllocated));
+    profiler.RecordCounter("World Bytes Used", static_cast<double>(stats.bytesUsed));
+    profiler.RecordCounter("Entity Bookkeeping Bytes", static_cast<double>(stats.entities.bytesAllocated));
+    profiler.RecordCounter("Archetypes", static_cast<double>(stats.archetypes.size()));
+    profiler.RecordCounter("Empty Archetypes", static_cast<double>(stats.emptyArchetypes));
+}
@@ -0,0 +1,176 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <ostream>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+namespace Weave
+{
+    namespace ECS
+    {
+        struct WorldMemoryStats;
+    }
+
+    namespace Utilities
+    {
+        // Collects timed scopes into one ring buffer per thread. Recording takes no lock, the oldest events are
+        // overwritten once a buffer is full. Exporting should happen while nothing is recording, between frames.
+        class Profiler
+        {
+        public:
+            enum class EventType : std::uint8_t
+            {
+                Scope,
+                Counter
+            };
+
+            struct Event
+            {
+                const char* name;
+                std::uint64_t begin;
+                std::uint64_t end;
+                double value = 0.0; // Only used by counters, which happen at begin.
+                EventType type = EventType::Scope;
+            };
+
+        private:
+            struct ThreadBuffer
+            {
+                std::unique_ptr<Event[]> events;
+                std::size_t capacity;
+                std::atomic<std::uint64_t> written = 0;
+
+                std::size_t thread;
+                std::string name;
+            };
+
+            std::mutex mutex;
+            std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+            std::unordered_set<std::string> names;
+            std::size_t bufferCapacity = 1 << 16;
+            std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+            ThreadBuffer& GetThreadBuffer()
+            {
+                thread_local ThreadBuffer* buffer = nullptr;
+                if (buffer) return *buffer;
+
+                std::lock_guard<std::mutex> lock(mutex);
+                auto newBuffer = std::make_unique<ThreadBuffer>();
+                newBuffer->events = std::make_unique<Event[]>(bufferCapacity);
+                newBuffer->capacity = bufferCapacity;
+                newBuffer->thread = buffers.size();
+                newBuffer->name = "Thread " + std::to_string(buffers.size());
+
+                buffer = newBuffer.get();
+                buffers.push_back(std::move(newBuffer));
+
+                return *buffer;
+            }
+
+            void Push(const Event& event)
+            {
+                ThreadBuffer& buffer = GetThreadBuffer();
+                std::uint64_t index = buffer.written.load(std::memory_order_relaxed);
+
+                buffer.events[index % buffer.capacity] = event;
+                buffer.written.store(index + 1, std::memory_order_release);
+            }
+
+        public:
+            static Profiler& Get()
+            {
+                static Profiler profiler;
+                return profiler;
+            }
+
+            // Nanoseconds since the profiler was created.
+            std::uint64_t Now() const
+            {
+                return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+            }
+
+            // name must outlive the profiler, use Intern for names built at runtime.
+            void Record(const char* name, std::uint64_t begin, std::uint64_t end)
+            {
+                Push({ name, begin, end });
+            }
+
+            // Samples a value that is drawn as a counter track, name follows the same rules as for Record.
+            void RecordCounter(const char* name, double value)
+            {
+                std::uint64_t now = Now();
+                Push({ name, now, now, value, EventType::Counter });
+            }
+
+            const char* Intern(std::string_view name)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                return names.emplace(name).first->c_str();
+            }
+
+            void SetThreadName(std::string_view name)
+            {
+                ThreadBuffer& buffer = GetThreadBuffer();
+
+                std::lock_guard<std::mutex> lock(mutex);
+                buffer.name = name;
+            }
+
+            // Applies to threads that record for the first time afterwards.
+            void SetBufferCapacity(std::size_t events)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                bufferCapacity = events > 0 ? events : 1;
+            }
+
+            // Drops every recorded event, thread names are kept.
+            void Clear();
+
+            // Writes the recorded events in the Chrome trace event format, viewable in Perfetto or chrome://tracing.
+            void ExportChromeTrace(std::ostream& stream);
+            bool WriteChromeTrace(const std::string& path);
+        };
+
+        // Adds a world's memory totals as counter tracks, so memory can be followed over a session.
+        void RecordMemoryCounters(const ECS::WorldMemoryStats& stats);
+
+        class ProfileScope
+        {
+        private:
+            const char* name;
+            std::uint64_t begin;
+
+        public:
+            explicit ProfileScope(const char* name)
+                : name(name), begin(Profiler::Get().Now()) {}
+
+            ProfileScope(const ProfileScope&) = delete;
+            ProfileScope& operator=(const ProfileScope&) = delete;
+
+            ~ProfileScope()
+            {
+                Profiler& profiler = Profiler::Get();
+                profiler.Record(name, begin, profiler.Now());
+            }
+        };
+    }
+}
+
+#define WEAVE_PROFILE_CONCAT_INNER(a, b) a##b
+#define WEAVE_PROFILE_CONCAT(a, b) WEAVE_PROFILE_CONCAT_INNER(a, b)
+
+#ifdef WEAVE_ENABLE_PROFILING
+#define WEAVE_PROFILE_SCOPE(name) ::Weave::Utilities::ProfileScope WEAVE_PROFILE_CONCAT(weaveProfileScope, __LINE__)(name)
+#define WEAVE_PROFILE_THREAD_NAME(name) ::Weave::Utilities::Profiler::Get().SetThreadName(name)
+#else
+#define WEAVE_PROFILE_SCOPE(name) ((void)0)
+#define WEAVE_PROFILE_THREAD_NAME(name) ((void)0)
+#endif
@@ -1,12 +1,20 @@
 #pragma once
 #include <vector>
-#include <queue>
 #include <thread>
 #include <mutex>
-#include <condition_variable>
 #include <functional>
 #include <future>
 #include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <cstdint>
+#include <stdexcept>
+#include <exception>
+#include <algorithm>
+#include <string>
+#include "Profiler.h"
+#include "PerfCounters.h"
 
 namespace Weave
 {
@@ -14,62 +22,468 @@ namespace Weave
     {
         class ThreadPool
         {
+        public:
+            // Intrusive unit of work. Submitted jobs must stay alive until they have executed.
+            struct Job
+            {
+                void (*execute)(Job*);
+
+#ifdef WEAVE_ENABLE_PERF_COUNTERS
+                // Where the hardware counters of this job are added, usually the system that submitted it.
+                PerfCounterSink* counterSink = nullptr;
+#endif
+            };
+
         private:
-            std::vector<std::thread> workers;
-            std::queue<std::function<void()>> tasks;
-            std::mutex queueMutex;
-            std::condition_variable condition;
-            bool stop = false;
-            std::atomic<int> activeTasks{ 0 };
-            std::condition_variable completionCondition;
+            // Chase-Lev work stealing deque. The owning worker pushes and pops at the bottom,
+            // any other thread steals from the top.
+            class WorkStealingDeque
+            {
+            private:
+                struct Buffer
+                {
+                    std::int64_t capacity;
+                    std::unique_ptr<std::atomic<Job*>[]> slots;
+
+                    explicit Buffer(std::int64_t capacity) : capacity(capacity), slots(new std::atomic<Job*>[capacity]) {}
+
+                    Job* Get(std::int64_t index) { return slots[index & (capacity - 1)].load(std::memory_order_relaxed); }
+                    void Put(std::int64_t index, Job* job) { slots[index & (capacity - 1)].store(job, std::memory_order_relaxed); }
+                };
+
+                std::atomic<std::int64_t> top{ 0 };
+                std::atomic<std::int64_t> bottom{ 0 };
+                std::atomic<Buffer*> buffer;
+
+                // Thieves may still be reading a buffer after it has been replaced, so old buffers live as long as the deque.
+                std::vector<std::unique_ptr<Buffer>> buffers;
+
+            public:
+                WorkStealingDeque()
+                {
+                    buffers.push_back(std::make_unique<Buffer>(256));
+                    buffer.store(buffers.back().get(), std::memory_order_relaxed);
+                }
+
+                void Push(Job* job)
+                {
+                    std::int64_t b = bottom.load(std::memory_order_relaxed);
+                    std::int64_t t = top.load(std::memory_order_acquire);
+                    Buffer* current = buffer.load(std::memory_order_relaxed);
+
+                    if (b - t > current->capacity - 1)
+                    {
+                        buffers.push_back(std::make_unique<Buffer>(current->capacity * 2));
+                        Buffer* grown = buffers.back().get();
+
+                        for (std::int64_t i = t; i < b; i++) grown->Put(i, current->Get(i));
+
+                        buffer.store(grown, std::memory_order_release);
+                        current = grown;
+                    }
+
+                    current->Put(b, job);
+                    bottom.store(b + 1, std::memory_order_release);
+                }
+
+                Job* Pop()
+                {
+                    std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+                    Buffer* current = buffer.load(std::memory_order_relaxed);
+                    bottom.store(b, std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    std::int64_t t = top.load(std::memory_order_relaxed);
+
+                    if (t > b)
+                    {
+                        bottom.store(b + 1, std::memory_order_relaxed);
+                        return nullptr;
+                    }
+
+                    Job* job = current->Get(b);
+
+                    if (t == b)
+                    {
+                        // Last job, race any thief for it.
+                        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) job = nullptr;
+                        bottom.store(b + 1, std::memory_order_relaxed);
+                    }
+
+                    return job;
+                }
+
+                Job* Steal()
+                {
+                    std::int64_t t = top.load(std::memory_order_acquire);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    std::int64_t b = bottom.load(std::memory_order_acquire);
+
+                    if (t >= b) return nullptr;
+
+                    Job* job = buffer.load(std::memory_order_acquire)->Get(t);
+
+                    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return nullptr;
+
+                    return job;
+                }
+            };
+
+            struct Worker
+            {
+                WorkStealingDeque deque;
+                std::thread thread;
+            };
+
+            template <typename F>
+            struct FunctionJob : Job
+            {
+                F function;
+
+                explicit FunctionJob(F&& function) : Job{ &Execute }, function(std::move(function)) {}
+
+                static void Execute(Job* job)
+                {
+                    FunctionJob* self = static_cast<FunctionJob*>(job);
+                    self->function();
+                    delete self;
+                }
+            };
+
+            // Shared state of one ParallelFor call. It lives on the caller's stack and the same pointer is submitted
+            // once per helping worker, each execution claims chunks until the range is exhausted.
+            struct ParallelForJob : Job
+            {
+                std::atomic<std::size_t> next{ 0 };
+                std::atomic<std::size_t> pendingHelpers{ 0 };
+                std::atomic<bool> failed{ false };
+                std::exception_ptr exception;
+
+                std::size_t count;
+                std::size_t grain;
+                std::size_t participants;
+
+                void (*invoke)(void*, std::size_t, std::size_t);
+                void* function;
+
+                ParallelForJob(std::size_t count, std::size_t grain, std::size_t participants, void (*invoke)(void*, std::size_t, std::size_t), void* function)
+                    : Job{ &ExecuteHelper }, count(count), grain(grain), participants(participants), invoke(invoke), function(function) {}
+
+                // Guided scheduling, chunks start large and shrink towards the grain as the range runs out.
+                bool Claim(std::size_t& begin, std::size_t& end)
+                {
+                    std::size_t current = next.load(std::memory_order_relaxed);
+
+                    while (current < count)
+                    {
+                        std::size_t remaining = count - current;
+                        std::size_t size = std::min(remaining, std::max(grain, remaining / (2 * participants)));
+
+                        if (next.compare_exchange_weak(current, current + size, std::memory_order_relaxed))
+                        {
+                            begin = current;
+                            end = current + size;
+                            return true;
+                        }
+                    }
+
+                    return false;
+                }
+
+                void Run()
+                {
+                    std::size_t begin, end;
+
+                    try
+                    {
+                        while (!failed.load(std::memory_order_relaxed) && Claim(begin, end)) invoke(function, begin, end);
+                    }
+                    catch (...)
+                    {
+                        if (!failed.exchange(true)) exception = std::current_exception();
+                    }
+                }
+
+                static void ExecuteHelper(Job* job)
+                {
+                    ParallelForJob* self = static_cast<ParallelForJob*>(job);
+                    self->Run();
+
+                    // The caller may return as soon as this reaches zero, self must not be touched afterwards.
+                    self->pendingHelpers.fetch_sub(1, std::memory_order_acq_rel);
+                }
+            };
+
+            static constexpr int SpinCount = 64;
+
+            std::vector<std::unique_ptr<Worker>> workers;
+
+            // Jobs submitted from threads outside the pool, workers submit to their own deque instead.
+            // A ring that only ever grows, so steady state submissions don't allocate.
+            std::mutex injectionMutex;
+            std::vector<Job*> injectionQueue = std::vector<Job*>(64);
+            std::size_t injectionHead = 0;
+            std::atomic<std::size_t> injectedCount{ 0 };
+
+            std::atomic<std::uint32_t> wakeSignal{ 0 };
+            std::atomic<int> sleepingWorkers{ 0 };
+            std::atomic<bool> stop{ false };
+
+            std::atomic<std::size_t> pendingJobs{ 0 };
+
+            static inline thread_local ThreadPool* currentPool = nullptr;
+            static inline thread_local std::size_t currentWorker = SIZE_MAX;
+            static inline thread_local std::minstd_rand stealRandom{ std::random_device{}() };
+
+            Job* PopInjected()
+            {
+                if (injectedCount.load(std::memory_order_acquire) == 0) return nullptr;
+
+                std::lock_guard<std::mutex> lock(injectionMutex);
+                std::size_t count = injectedCount.load(std::memory_order_relaxed);
+                if (count == 0) return nullptr;
+
+                Job* job = injectionQueue[injectionHead];
+                injectionHead = (injectionHead + 1) % injectionQueue.size();
+                injectedCount.store(count - 1, std::memory_order_relaxed);
+                return job;
+            }
+
+            Job* StealFromOthers(std::size_t self)
+            {
+                std::size_t count = workers.size();
+                if (count == 0) return nullptr;
+
+                std::size_t start = stealRandom() % count;
+
+                for (std::size_t i = 0; i < count; i++)
+                {
+                    std::size_t victim = (start + i) % count;
+                    if (victim == self) continue;
+
+                    if (Job* job = workers[victim]->deque.Steal()) return job;
+                }
+
+                return nullptr;
+            }
+
+            Job* FindJob(std::size_t self)
+            {
+                if (self < workers.size())
+                {
+                    if (Job* job = workers[self]->deque.Pop()) return job;
+                }
+
+                if (Job* job = PopInjected()) return job;
+
+                return StealFromOthers(self);
+            }
+
+            void Execute(Job* job)
+            {
+                {
+                    WEAVE_PROFILE_SCOPE("Pool Task");
+                    WEAVE_PERF_COUNTER_SCOPE(job->counterSink);
+                    job->execute(job);
+                }
+
+                if (pendingJobs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    pendingJobs.notify_all();
+                }
+            }
+
+            void WorkerLoop(std::size_t index)
+            {
+                currentPool = this;
+                currentWorker = index;
+
+                WEAVE_PROFILE_THREAD_NAME("Weave Worker " + std::to_string(index));
+
+                while (true)
+                {
+                    Job* job = FindJob(index);
+
+                    for (int spin = 0; !job && spin < SpinCount; spin++)
+                    {
+                        std::this_thread::yield();
+                        job = FindJob(index);
+                    }
+
+                    if (job)
+                    {
+                        Execute(job);
+                        continue;
+                    }
+
+                    // Park until the next submission. The signal is read before announcing the sleep,
+                    // so a submission racing with the final check changes it and the wait returns at once.
+                    std::uint32_t signal = wakeSignal.load(std::memory_order_seq_cst);
+                    sleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+
+                    job = FindJob(index);
+
+                    if (!job && !stop.load(std::memory_order_acquire))
+                    {
+                        wakeSignal.wait(signal, std::memory_order_seq_cst);
+                    }
+
+                    sleepingWorkers.fetch_sub(1, std::memory_order_seq_cst);
+
+                    if (job)
+                    {
+                        Execute(job);
+                        continue;
+                    }
+
+                    if (stop.load(std::memory_order_acquire) && pendingJobs.load(std::memory_order_acquire) == 0) return;
+                }
+            }
+
+            void WakeWorker()
+            {
+                wakeSignal.fetch_add(1, std::memory_order_seq_cst);
+
+                if (sleepingWorkers.load(std::memory_order_seq_cst) > 0)
+                {
+                    wakeSignal.notify_one();
+                }
+            }
 
         public:
             explicit ThreadPool(size_t numThreads)
             {
                 for (size_t i = 0; i < numThreads; ++i)
                 {
-                    workers.emplace_back([this]() {
-                        while (true)
-                        {
-                            std::function<void()> task;
-                            {
-                                std::unique_lock<std::mutex> lock(queueMutex);
-                                condition.wait(lock, [this] { return stop || !tasks.empty(); });
+                    workers.push_back(std::make_unique<Worker>());
+                }
+
+                // Workers steal from each other, so every deque has to exist before the first thread starts.
+                for (size_t i = 0; i < numThreads; ++i)
+                {
+                    workers[i]->thread = std::thread([this, i]() { WorkerLoop(i); });
+                }
+            }
 
-                                if (stop && tasks.empty()) return;
+            ThreadPool(const ThreadPool&) = delete;
+            ThreadPool& operator=(const ThreadPool&) = delete;
 
-                                task = std::move(tasks.front());
-                                tasks.pop();
-                                activeTasks++;
-                            }
+            // Queues a job without taking ownership. Jobs submitted from a worker of this pool go to the
+            // front of its own deque, so tasks can spawn subtasks without touching shared state.
+            void Submit(Job* job)
+            {
+                if (stop.load(std::memory_order_relaxed)) throw std::runtime_error("ThreadPool has stopped accepting tasks.");
 
-                            task();
+                pendingJobs.fetch_add(1, std::memory_order_relaxed);
 
-                            {
-                                std::lock_guard<std::mutex> lock(queueMutex);
-                                activeTasks--;
-                                if (activeTasks == 0 && tasks.empty()) {
-                                    completionCondition.notify_all();
-                                }
-                            }
-                        }});
+                if (currentPool == this)
+                {
+                    workers[currentWorker]->deque.Push(job);
                 }
+                else
+                {
+                    std::lock_guard<std::mutex> lock(injectionMutex);
+                    std::size_t count = injectedCount.load(std::memory_order_relaxed);
+
+                    if (count == injectionQueue.size())
+                    {
+                        std::vector<Job*> grown(injectionQueue.size() * 2);
+                        for (std::size_t i = 0; i < count; i++) grown[i] = injectionQueue[(injectionHead + i) % injectionQueue.size()];
+
+                        injectionQueue = std::move(grown);
+                        injectionHead = 0;
+                    }
+
+                    injectionQueue[(injectionHead + count) % injectionQueue.size()] = job;
+                    injectedCount.store(count + 1, std::memory_order_release);
+                }
+
+                WakeWorker();
             }
 
             template <typename F, typename... Args>
             auto Enqueue(F&& f, Args&&... args) -> std::future<typename std::invoke_result<F, Args...>::type>
             {
                 using ReturnType = typename std::invoke_result<F, Args...>::type;
-                auto task = std::make_shared<std::packaged_task<ReturnType()>>(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+                std::packaged_task<ReturnType()> task(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+
+                std::future<ReturnType> result = task.get_future();
+                Job* job = new FunctionJob<std::packaged_task<ReturnType()>>(std::move(task));
+
+#ifdef WEAVE_ENABLE_PERF_COUNTERS
+                job->counterSink = PerfCounters::GetCurrentSink();
+#endif
+                Submit(job);
+                return result;
+            }
+
+            // Calls fn(begin, end) over disjoint sub ranges covering [0, count). The calling thread takes part and the
+            // call returns once every sub range has been processed. Nothing is allocated, the job is on this stack
+            // frame. A grain of 0 picks one from the range and thread count.
+            template <typename F>
+            void ParallelFor(std::size_t count, std::size_t grain, F&& fn)
+            {
+                if (count == 0) return;
 
-                std::future<ReturnType> result = task->get_future();
+                std::size_t threads = workers.size() + 1;
+                if (grain == 0) grain = std::max<std::size_t>(1, count / (threads * 32));
+
+                std::size_t chunks = (count + grain - 1) / grain;
+                std::size_t helpers = std::min(workers.size(), chunks - 1);
+
+                if (helpers == 0)
                 {
-                    std::lock_guard<std::mutex> lock(queueMutex);
-                    if (stop) throw std::runtime_error("ThreadPool has stopped accepting tasks.");
-                    tasks.emplace([task]() { (*task)(); });
+                    fn(std::size_t(0), count);
+                    return;
                 }
-                condition.notify_one();
-                return result;
+
+                using Function = std::remove_reference_t<F>;
+                auto invoke = [](void* function, std::size_t begin, std::size_t end) { (*static_cast<Function*>(function))(begin, end); };
+
+                ParallelForJob job(count, grain, helpers + 1, invoke, const_cast<void*>(static_cast<const void*>(std::addressof(fn))));
+                job.pendingHelpers.store(helpers, std::memory_order_relaxed);
+
+#ifdef WEAVE_ENABLE_PERF_COUNTERS
+                job.counterSink = PerfCounters::GetCurrentSink();
+#endif
+
+                for (std::size_t i = 0; i < helpers; i++) Submit(&job);
+
+                job.Run();
+
+                // Helpers that haven't been picked up yet only find an exhausted range, running them here just retires them.
+                while (job.pendingHelpers.load(std::memory_order_acquire) != 0)
+                {
+                    if (!TryRunPendingTask()) std::this_thread::yield();
+                }
+
+                if (job.exception) std::rethrow_exception(job.exception);
+            }
+
+            // Runs one queued job on the calling thread, returns false when no job could be found.
+            // Lets threads that wait on pool work help instead of blocking a worker.
+            bool TryRunPendingTask()
+            {
+                std::size_t self = currentPool == this ? currentWorker : SIZE_MAX;
+                Job* job = FindJob(self);
+
+                if (!job) return false;
+
+                Execute(job);
+                return true;
+            }
+
+            template <typename T>
+            void WaitFor(std::future<T>& future)
+            {
+                while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                {
+                    if (!TryRunPendingTask()) std::this_thread::yield();
+                }
+            }
+
+            bool IsWorkerThread() const
+            {
+                return currentPool == this;
             }
 
             size_t GetThreadCount()
@@ -79,23 +493,25 @@ namespace Weave
 
             void WaitAll()
             {
-                std::unique_lock<std::mutex> lock(queueMutex);
-                completionCondition.wait(lock, [this]() {
-                    return tasks.empty() && activeTasks == 0;
-                    });
+                while (true)
+                {
+                    std::size_t pending = pendingJobs.load(std::memory_order_acquire);
+                    if (pending == 0) return;
+
+                    if (!TryRunPendingTask()) pendingJobs.wait(pending, std::memory_order_acquire);
+                }
             }
 
             ~ThreadPool()
             {
-                {
-                    std::lock_guard<std::mutex> lock(queueMutex);
-                    stop = true;
-                }
-                condition.notify_all();
-                for (std::thread& worker : workers) {
-                    if (worker.joinable()) worker.join();
+                stop.store(true, std::memory_order_release);
+                wakeSignal.fetch_add(1, std::memory_order_seq_cst);
+                wakeSignal.notify_all();
+
+                for (std::unique_ptr<Worker>& worker : workers) {
+                    if (worker->thread.joinable()) worker->thread.join();
                 }
             }
         };
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <vector>
+#include <mutex>
+#include <cstddef>
+
+namespace Weave
+{
+    namespace Utilities
+    {
+        // Small dense index for the calling thread, stable for the thread's lifetime and recycled when it exits.
+        // Lets per-thread storage be a plain array lookup instead of a locked map.
+        class ThreadSlot
+        {
+        private:
+            struct Registry
+            {
+                std::mutex mutex;
+                std::vector<std::size_t> freeSlots;
+                std::size_t nextSlot = 0;
+            };
+
+            static Registry& GetRegistry()
+            {
+                static Registry registry;
+                return registry;
+            }
+
+            struct Holder
+            {
+                std::size_t slot;
+
+                Holder()
+                {
+                    Registry& registry = GetRegistry();
+                    std::lock_guard<std::mutex> lock(registry.mutex);
+
+                    if (registry.freeSlots.empty())
+                    {
+                        slot = registry.nextSlot++;
+                    }
+                    else
+                    {
+                        slot = registry.freeSlots.back();
+                        registry.freeSlots.pop_back();
+                    }
+                }
+
+                ~Holder()
+                {
+                    Registry& registry = GetRegistry();
+                    std::lock_guard<std::mutex> lock(registry.mutex);
+                    registry.freeSlots.push_back(slot);
+                }
+            };
+
+        public:
+            static std::size_t Current()
+            {
+                thread_local Holder holder;
+                return holder.slot;
+            }
+        };
+    }
+}